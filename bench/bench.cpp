@@ -0,0 +1,978 @@
+/**
+ * @file bench.cpp
+ * @brief Host benchmark of the firmware request handlers against the mock ST7735
+ *
+ * Build and run with `pio run -e native -t exec`.
+ */
+
+#include <Arduino.h>
+#include <Adafruit_ST7735.h>
+#include <WebServer.h>
+#include <WebSocketsServer.h>
+#include <WiFi.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "animation.h"
+#include "canvas.h"
+#include "history.h"
+#include "lcd_dma.h"
+#include "panel_array.h"
+#include "screen_mirror.h"
+#include "text_renderer.h"
+
+// CPU cost of converting one pixel into a DMA line buffer (~3 cycles at 240 MHz)
+#define CPU_SWAP_NS_PER_PIXEL 12.5
+
+extern Adafruit_ST7735 tft;
+extern WebServer server;
+extern WebSocketsServer webSocket;
+extern Canvas canvas;
+extern LcdDma lcd;
+extern PanelArray panels;
+extern ScreenMirror screen;
+extern History history;
+
+void setup(void);
+void loop(void);
+void connectToWifi();
+uint32_t renderBacklog();
+extern TextRenderer textRenderer;
+extern unsigned long renderTickMs;
+extern std::atomic<bool> flushPending;
+extern std::atomic<uint32_t> updatesRendered;
+extern std::atomic<uint32_t> updatesCoalesced;
+extern std::atomic<bool> animationPlaying;
+extern std::atomic<uint32_t> framesShown;
+extern std::atomic<uint32_t> framesDropped;
+bool ringStress();
+bool replayTraces(const char *dir);
+std::vector<uint8_t> testImage(int size);
+uint16_t toRgb565(const uint8_t *px);
+std::vector<uint8_t> encodeRgb565(const std::vector<uint8_t> &rgb);
+std::vector<uint8_t> encodeRle(const std::vector<uint8_t> &rgb);
+std::vector<uint8_t> encodeQoi(const std::vector<uint8_t> &rgb, uint32_t width, uint32_t height);
+
+/**
+ * @brief Wait until the render task has drawn everything queued so far
+ *
+ */
+static void waitRender() {
+  while (renderBacklog() > 0 || flushPending) {
+    yield();
+  }
+}
+
+static int failedChecks = 0;
+
+/**
+ * @brief Text of a check result; every failed check makes the run exit
+ *        with status 1
+ *
+ * @param ok 
+ * @param pass printed when ok
+ * @param fail printed otherwise
+ * @return const char* 
+ */
+static const char *check(bool ok, const char *pass = "ok", const char *fail = "FAIL") {
+  if (!ok) {
+    failedChecks++;
+  }
+  return ok ? pass : fail;
+}
+
+/**
+ * @brief Form arguments of a /draw request with every n-th cell checked
+ *
+ * @param step 
+ * @param color 
+ * @return MockArgs 
+ */
+static MockArgs gridArgs(int step, int color) {
+  MockArgs args;
+  char name[12];
+
+  for (int i = 0; i < GridLayout::CELLS; i += step) {
+    sprintf(name, "%d-%d", i / GridLayout::SIZE, i % GridLayout::SIZE);
+    args.push_back({name, "on"});
+  }
+  args.push_back({"textColor", String(color)});
+  return args;
+}
+
+// ETag of the index page as cached by the replaying "browser"
+static String cachedEtag;
+
+/**
+ * @brief Follow a redirect the way a browser does, revalidating the
+ *        cached index page
+ *
+ * @param res response of the original request, updated in place
+ * @param trips number of HTTP round trips so far
+ */
+static void followRedirect(MockResponse &res, int &trips) {
+  if (res.code != 302) {
+    return;
+  }
+
+  MockArgs headers;
+  if (!cachedEtag.isEmpty()) {
+    headers.push_back({"If-None-Match", cachedEtag});
+  }
+  MockResponse next = server.mockRequest(HTTP_GET, res.header("Location"), MockArgs(), headers);
+
+  res.headerBytes += next.headerBytes;
+  res.bodyBytes += next.bodyBytes;
+  trips++;
+}
+
+/**
+ * @brief Print one result row
+ *
+ * @param label 
+ * @param res 
+ * @param trips 
+ * @param elapsed 
+ */
+static void report(const char *label, const MockResponse &res, int trips, unsigned long elapsed) {
+  printf("%-22s %4d %10lu %10lu %10lu %10zu %5d %8lu us %6s\n",
+         label, res.code, mockBus.transactions, mockBus.windows, mockBus.bytes,
+         res.headerBytes + res.bodyBytes, trips, elapsed, res.header("X-Cells-Changed").c_str());
+}
+
+/**
+ * @brief Run one request and print its bus cost
+ *
+ * @param label 
+ * @param method 
+ * @param uri 
+ * @param args 
+ * @param headers 
+ * @return MockResponse 
+ */
+static MockResponse run(const char *label, HTTPMethod method, const char *uri, const MockArgs &args,
+                        const MockArgs &headers = MockArgs()) {
+  int trips = 1;
+
+  mockBusReset();
+  unsigned long start = micros();
+  MockResponse res = server.mockRequest(method, uri, args, headers);
+  followRedirect(res, trips);
+  waitRender();
+  unsigned long elapsed = micros() - start;
+
+  report(label, res, trips, elapsed);
+  return res;
+}
+
+/**
+ * @brief Run one request with a binary body and print its bus cost
+ *
+ * @param label 
+ * @param uri 
+ * @param body 
+ * @param length 
+ */
+static void runRaw(const char *label, const char *uri, const uint8_t *body, size_t length) {
+  int trips = 1;
+
+  mockBusReset();
+  unsigned long start = micros();
+  MockResponse res = server.mockRawRequest(HTTP_POST, uri, body, length);
+  followRedirect(res, trips);
+  waitRender();
+  unsigned long elapsed = micros() - start;
+
+  report(label, res, trips, elapsed);
+}
+
+/**
+ * @brief Deliver one WebSocket frame and print its bus cost
+ *
+ * @param label 
+ * @param payload 
+ * @param length 
+ */
+static void runWs(const char *label, uint8_t *payload, size_t length) {
+  mockBusReset();
+  unsigned long sent = webSocket.sentBytes;
+  unsigned long start = micros();
+  webSocket.mockReceive(0, WStype_BIN, payload, length);
+  waitRender();
+  unsigned long elapsed = micros() - start;
+
+  printf("%-22s %4s %10lu %10lu %10lu %10lu %5d %8lu us\n",
+         label, "ws", mockBus.transactions, mockBus.windows, mockBus.bytes,
+         webSocket.sentBytes - sent, 0, elapsed);
+}
+
+/**
+ * @brief Check that the mock panels show exactly their tiles of the
+ *        canvas, rows shifted by each panel's vertical scroll
+ *
+ * @return true 
+ * @return false 
+ */
+static bool panelMatchesCanvas() {
+  for (uint8_t i = 0; i < panels.count(); i++) {
+    const Adafruit_SPITFT &panel = *panels.display(i);
+    int16_t w = panel.width(), h = panel.height();
+    int16_t left = i % PANEL_COLS * w, top = i / PANEL_COLS * h;
+
+    for (int16_t y = 0; y < h; y++) {
+      for (int16_t x = 0; x < w; x++) {
+        if (panel.shownPixel(x, y) != canvas.getPixel(left + x, top + (y + panel.shownScroll()) % h)) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief RGB565 colours of the whole canvas
+ *
+ * @return std::vector<uint16_t> 
+ */
+static std::vector<uint16_t> canvasFrame() {
+  std::vector<uint16_t> frame;
+
+  for (int16_t y = 0; y < canvas.height(); y++) {
+    for (int16_t x = 0; x < canvas.width(); x++) {
+      frame.push_back(canvas.getPixel(x, y));
+    }
+  }
+  return frame;
+}
+
+/**
+ * @brief Viewer side of the screen mirror: take the events written to the
+ *        stream and fetch every dirty region from /screen into frame
+ *
+ * @param viewer event stream
+ * @param frame mirrored screen, canvas sized
+ * @param fetched bytes of RLE received
+ * @return int dirty events handled
+ */
+static int followScreen(WiFiClient &viewer, std::vector<uint16_t> &frame, size_t &fetched) {
+  std::string stream = viewer.mockTake();
+  int events = 0;
+
+  for (size_t pos = 0; (pos = stream.find("event: dirty\ndata: ", pos)) != std::string::npos;) {
+    pos += 19;
+    std::string data = stream.substr(pos, stream.find('\n', pos) - pos);
+    events++;
+    for (size_t r = 0; r < data.size();) {
+      int x, y, w, h, used;
+      if (sscanf(data.c_str() + r, "%d,%d,%d,%d%n", &x, &y, &w, &h, &used) != 4) break;
+      r += used + 1;
+
+      MockResponse res = server.mockRequest(HTTP_GET, "/screen", {{"x", String(x)}, {"y", String(y)},
+                                                                  {"w", String(w)}, {"h", String(h)}});
+      const uint8_t *rle = (const uint8_t *)res.body.c_str();
+      size_t p = 0;
+      fetched += res.body.length();
+      for (size_t i = 0; i + 2 < res.body.length(); i += 3) {
+        for (int n = 0; n <= rle[i]; n++, p++) {
+          frame[(y + p / w) * canvas.width() + x + p % w] = rle[i + 1] | rle[i + 2] << 8;
+        }
+      }
+    }
+  }
+  return events;
+}
+
+/**
+ * @brief Check that a mirrored frame equals what the mock panels show
+ *
+ * @param frame 
+ * @return true 
+ * @return false 
+ */
+static bool mirrorMatchesPanels(const std::vector<uint16_t> &frame) {
+  for (uint8_t i = 0; i < panels.count(); i++) {
+    const Adafruit_SPITFT &panel = *panels.display(i);
+    int16_t left = i % PANEL_COLS * panel.width(), top = i / PANEL_COLS * panel.height();
+
+    for (int16_t y = 0; y < panel.height(); y++) {
+      for (int16_t x = 0; x < panel.width(); x++) {
+        if (frame[(top + y) * canvas.width() + left + x] != panel.shownPixel(x, y)) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Flush throughput of the blocking Adafruit path and the DMA path
+ *
+ * @param label 
+ * @param cells cells filled per frame, 0 for a full screen fill
+ */
+static void flushBenchmark(const char *label, int cells) {
+  const int frames = 50;
+
+  for (int dma = 0; dma < 2; dma++) {
+    unsigned long pixels = 0;
+    bool match = true;
+
+    mockBusReset();
+    for (int f = 0; f < frames; f++) {
+      uint16_t color = f * 0x0841 + 0x1234;
+      if (cells == 0) {
+        canvas.fillScreen(color);
+        pixels += canvas.width() * canvas.height();
+      }
+      for (int c = 0; c < cells; c++) {
+        int cell = (f * 37 + c * 101) % GridLayout::CELLS;
+        canvas.fillRect(cell % GridLayout::SIZE * GridLayout::CELL, cell / GridLayout::SIZE * GridLayout::CELL,
+                        GridLayout::CELL, GridLayout::CELL, color + c);
+        pixels += GridLayout::CELL * GridLayout::CELL;
+      }
+      panels.setDma(dma ? &lcd : NULL);
+      panels.flush(canvas);
+      lcd.finish();
+      match = match && panelMatchesCanvas();
+    }
+
+    double cpu = mockBus.cpuNanos + (dma ? pixels * CPU_SWAP_NS_PER_PIXEL : 0);
+    double frame = max(mockBus.busNanos, cpu) / frames;
+    printf("%-16s %-9s %10.0f %10.0f %8.1f %6s\n", label, dma ? "dma" : "blocking",
+           mockBus.busNanos / frames / 1000, cpu / frames / 1000, 1e9 / frame, check(match, "yes", "NO"));
+  }
+  panels.setDma(&lcd);
+}
+
+/**
+ * @brief Render cost of one grid resolution: host time to fill every cell through
+ *        fillRect and through the specialized fillCell kernel, bus time of
+ *        flushing the whole grid, and the windows, bytes and bus time of
+ *        flushing 16 scattered cells
+ *
+ */
+template <int Size>
+static void gridBenchmark() {
+  typedef GridConfig<Size, 128 / Size> Layout;
+  const int rounds = 50;
+
+  unsigned long start = micros();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < Layout::CELLS; i++) {
+      canvas.fillRect(i % Size * Layout::CELL, i / Size * Layout::CELL, Layout::CELL, Layout::CELL, r * 0x0841);
+    }
+  }
+  double rectUs = (double)(micros() - start) / rounds;
+  start = micros();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < Layout::CELLS; i++) {
+      canvas.fillCell<Layout::CELL>(i % Size, i / Size, (uint16_t)(r * 0x0841));
+    }
+  }
+  double cellUs = (double)(micros() - start) / rounds;
+  panels.flush(canvas);
+  lcd.finish();
+
+  canvas.fillScreen(ST77XX_BLACK);
+  mockBusReset();
+  panels.flush(canvas);
+  lcd.finish();
+  double fullBus = mockBus.busNanos;
+
+  uint32_t windows = canvas.windowsFlushed(), bytes = canvas.bytesFlushed();
+  mockBusReset();
+  for (int c = 0; c < 16; c++) {
+    int cell = (c * 101 + 7) % Layout::CELLS;
+    canvas.fillCell<Layout::CELL>(cell % Size, cell / Size, (uint16_t)ST77XX_GREEN);
+  }
+  panels.flush(canvas);
+  lcd.finish();
+
+  char label[16];
+  snprintf(label, sizeof(label), "%dx%d@%d", Size, Size, (int)Layout::CELL);
+  printf("%-16s %10.1f %10.1f %10.0f %8u %10u %10.0f\n", label, rectUs, cellUs, fullBus / 1000, (unsigned)(canvas.windowsFlushed() - windows),
+         (unsigned)(canvas.bytesFlushed() - bytes), mockBus.busNanos / 1000);
+}
+
+/**
+ * @brief Canvas of 2x2 mock panels on one bus. Every frame changes
+ *        scattered cells and a text line across all tiles; the panel array
+ *        flush is compared with sending each dirty region to the panels it
+ *        covers in canvas order, on the blocking and on the DMA path.
+ *
+ */
+static void tiledBenchmark() {
+  const int frames = 20;
+  const int8_t cs[] = {40, 41, 42, 43};
+  Adafruit_ST7735 *displays[4];
+  Canvas tiled(256, 256);
+  PanelArray array(2, 2, 128, 128);
+  LcdDma dma(18, 23, -1, 2, MOCK_PANEL_XSTART, MOCK_PANEL_YSTART);
+
+  for (int i = 0; i < 4; i++) {
+    displays[i] = new Adafruit_ST7735(cs[i], 2, -1);
+    array.setPanel(i % 2, i / 2, displays[i], cs[i]);
+  }
+  dma.begin(27000000, 128);
+
+  for (int useDma = 0; useDma < 2; useDma++) {
+    array.setDma(useDma ? &dma : NULL);
+    for (int scheduled = 0; scheduled < 2; scheduled++) {
+      bool match = true;
+
+      tiled.fillScreen(ST77XX_BLACK);
+      array.flush(tiled);
+      mockBusReset();
+      for (int f = 0; f < frames; f++) {
+        for (int c = 0; c < 6; c++) {
+          int cell = (f * 37 + c * 101) % 256;
+          tiled.fillRect(cell % 16 * 16, cell / 16 * 16, 16, 16, ST77XX_RED + f * 0x0841 + c);
+        }
+        tiled.setCursor(4, 120 + f % 4);
+        tiled.setTextColor(ST77XX_WHITE, ST77XX_BLACK);
+        tiled.setTextSize(2);
+        tiled.print("tiles across the bus");
+
+        if (scheduled) {
+          array.flush(tiled);
+        } else {
+          for (uint8_t j = 0; j < tiled.regionCount(); j++) {
+            const DirtyRect &r = tiled.region(j);
+            for (int i = 0; i < 4; i++) {
+              int16_t left = i % 2 * 128, top = i / 2 * 128;
+              int16_t x1 = max(r.x, left), y1 = max(r.y, top);
+              int16_t x2 = min((int16_t)(r.x + r.w), (int16_t)(left + 128));
+              int16_t y2 = min((int16_t)(r.y + r.h), (int16_t)(top + 128));
+              if (x1 >= x2 || y1 >= y2) continue;
+              DirtyRect clip = {x1, y1, (int16_t)(x2 - x1), (int16_t)(y2 - y1)};
+              if (useDma) {
+                dma.select(cs[i]);
+                tiled.writeRegion(dma, clip, x1 - left, y1 - top);
+              } else {
+                displays[i]->startWrite();
+                tiled.writeRegion(*displays[i], clip, x1 - left, y1 - top);
+                displays[i]->endWrite();
+              }
+            }
+          }
+          tiled.clearDirty();
+        }
+        dma.finish();
+
+        for (int i = 0; i < 4; i++) {
+          for (int y = 0; y < 128 && match; y++) {
+            for (int x = 0; x < 128 && match; x++) {
+              match = displays[i]->shownPixel(x, y) == tiled.getPixel(i % 2 * 128 + x, i / 2 * 128 + y);
+            }
+          }
+        }
+      }
+
+      printf("%-16s %-9s %10lu %10lu %10lu %10.0f %6s\n", scheduled ? "panel array" : "canvas order",
+             useDma ? "dma" : "blocking", mockBus.panelSwitches / frames, mockBus.transactions / frames,
+             mockBus.windows / frames, mockBus.busNanos / frames / 1000, check(match, "yes", "NO"));
+    }
+  }
+  array.setDma(NULL);
+}
+
+/**
+ * @brief Characters per second of Adafruit_GFX text output against the
+ *        glyph cache, both drawing size 2 text into the canvas
+ *
+ */
+static void textBenchmark() {
+  const char *sample = "The quick brown fox jumps over the lazy dog 0123456789";
+  const size_t length = strlen(sample);
+  const int rounds = 500;
+
+  for (int cached = 0; cached < 2; cached++) {
+    TextRenderer renderer(canvas, NULL);
+    unsigned long elapsed = 0;
+
+    for (int r = 0; r < rounds; r++) {
+      canvas.fillScreen(ST7735_BLACK);
+      unsigned long start = micros();
+      if (cached) {
+        renderer.home();
+        renderer.setStyle(2, ST7735_WHITE);
+        renderer.write((const uint8_t *)sample, length);
+        renderer.endWord();
+      } else {
+        canvas.setCursor(0, 0);
+        canvas.setTextSize(2);
+        canvas.setTextColor(ST7735_WHITE);
+        canvas.print(sample);
+      }
+      elapsed += micros() - start;
+    }
+
+    mockBusReset();
+    panels.flush(canvas);
+    lcd.finish();
+    printf("%-16s %10.0f %8lu %10lu %7u/%u\n", cached ? "glyph cache" : "adafruit gfx",
+           rounds * length * 1e6 / max(elapsed, 1UL), mockBus.windows, mockBus.bytes,
+           (unsigned)renderer.cacheHits(), (unsigned)renderer.cacheMisses());
+  }
+}
+
+/**
+ * @brief Upload an encoded image, check the panel shows the canvas, count
+ *        pixels that kept their exact colour in the palette and the mean
+ *        colour error of all pixels (RGB distance, 0..441)
+ *
+ * @param format 
+ * @param body 
+ * @param rgb expected picture
+ */
+static void runImage(const char *format, const std::vector<uint8_t> &body, const std::vector<uint8_t> &rgb) {
+  int exact = 0;
+  double error = 0;
+
+  mockBusReset();
+  unsigned long start = micros();
+  MockResponse res = server.mockRawRequest(HTTP_POST, "/image", body.data(), body.size(), {{"format", format}});
+  waitRender();
+  unsigned long elapsed = micros() - start;
+
+  for (int i = 0; i < 128 * 128; i++) {
+    uint16_t shown = tft.shownPixel(i % 128, i / 128), expected = toRgb565(&rgb[i * 3]);
+    int dr = ((shown >> 11) - (expected >> 11)) * 255 / 31;
+    int dg = (((shown >> 5) & 0x3F) - ((expected >> 5) & 0x3F)) * 255 / 63;
+    int db = ((shown & 0x1F) - (expected & 0x1F)) * 255 / 31;
+    exact += shown == expected;
+    error += sqrt(dr * dr + dg * dg + db * db);
+  }
+  // Upload to panel: the handler returns once the rows are queued, the
+  // panel cannot be done before the modelled bus is
+  double panelUs = std::max<double>(elapsed, mockBus.busNanos / 1e3);
+  printf("%-8s %4d %8zu %10lu %10lu %8lu us %9.1f %8.0f %6s %6.1f%% %5.1f\n", format, res.code, body.size(),
+         mockBus.transactions, mockBus.bytes, elapsed, mockBus.busNanos / 1e6, 128 * 128 / panelUs * 1e3,
+         check(panelMatchesCanvas(), "yes", "NO"), exact * 100.0 / (128 * 128), error / (128 * 128));
+}
+
+/**
+ * @brief Display list op with int16 little endian arguments
+ *
+ * @param op 
+ * @param args 
+ * @return std::vector<uint8_t> 
+ */
+static std::vector<uint8_t> displayOp(uint8_t op, std::initializer_list<int> args) {
+  std::vector<uint8_t> out = {op};
+
+  for (int a : args) {
+    out.push_back(a & 0xFF);
+    out.push_back((a >> 8) & 0xFF);
+  }
+  return out;
+}
+
+/**
+ * @brief Test scene of overlapping primitives, one display list op each
+ *
+ * @return std::vector<std::vector<uint8_t>> 
+ */
+static std::vector<std::vector<uint8_t>> testScene() {
+  std::vector<std::vector<uint8_t>> ops;
+
+  ops.push_back({0});
+  for (int i = 0; i < 8; i++) {
+    ops.push_back(displayOp(1, {10 + i * 6, 10 + i * 4, 40, 30, 0x1F << (i % 3) * 5}));
+  }
+  for (int i = 0; i < 6; i++) {
+    ops.push_back(displayOp(3, {0, i * 20, 127, 127 - i * 20, 0xFFFF}));
+  }
+  ops.push_back(displayOp(2, {2, 2, 124, 124, 0x07E0}));
+  ops.push_back(displayOp(4, {64, 64, 30, 0xF800}));
+  ops.push_back(displayOp(5, {96, 96, 12, 0x001F}));
+
+  std::vector<uint8_t> text = displayOp(6, {4, 100, 0xFFFF});
+  const char *label = "scene";
+  text.push_back(1);
+  text.push_back(strlen(label));
+  text.insert(text.end(), label, label + strlen(label));
+  ops.push_back(text);
+
+  std::vector<uint8_t> blit = displayOp(7, {100, 4, 16, 16});
+  for (int i = 0; i < 16 * 16; i++) {
+    blit.push_back(i * 7);
+    blit.push_back(i);
+  }
+  ops.push_back(blit);
+  return ops;
+}
+
+/**
+ * @brief Post a burst of draw and text updates, waiting for the panel after
+ *        each one or only at the end
+ *
+ * @param label 
+ * @param wait render every update before posting the next one
+ * @return std::vector<uint16_t> final canvas
+ */
+static std::vector<uint16_t> runBurst(const char *label, bool wait) {
+  const int updates = 12;
+
+  server.mockRequest(HTTP_POST, "/text", {{"text", "burst"}});
+  waitRender();
+  uint32_t rendered = updatesRendered, coalesced = updatesCoalesced;
+  mockBusReset();
+  unsigned long start = micros();
+  for (int i = 0; i < updates; i++) {
+    if (i == updates / 2) {
+      server.mockRequest(HTTP_POST, "/text", {{"text", "interrupted"}});
+    } else {
+      server.mockRequest(HTTP_POST, "/draw", gridArgs(i % 3 + 1, i % 4));
+    }
+    if (wait) {
+      waitRender();
+    }
+  }
+  waitRender();
+  printf("%-22s %4d %10lu %10lu %10lu %10s %5d %8lu us %6s\n", label, 204, mockBus.transactions, mockBus.windows,
+         mockBus.bytes, "-", updates, micros() - start, "");
+  printf("%-22s updates rendered %u, coalesced %u\n", "", (unsigned)(updatesRendered - rendered),
+         (unsigned)(updatesCoalesced - coalesced));
+  return canvasFrame();
+}
+
+/**
+ * @brief Cell codes of one animation frame: a two column bar moving right
+ *        over a filled background
+ *
+ * @param frame 
+ * @return std::vector<uint8_t> 
+ */
+static std::vector<uint8_t> animationFrame(int frame) {
+  std::vector<uint8_t> cells(GridLayout::CELLS);
+
+  for (int i = 0; i < GridLayout::CELLS; i++) {
+    int column = i % GridLayout::SIZE - frame % GridLayout::SIZE;
+    cells[i] = column >= 0 && column < 2 ? 3 : 1;
+  }
+  return cells;
+}
+
+/**
+ * @brief Upload an animation, let it play to the end and compare its bus
+ *        cost per frame with drawing each frame through /draw
+ *
+ */
+static void animationBenchmark() {
+  const int count = 20;
+  std::vector<uint8_t> body;
+
+  for (int f = 0; f < count; f++) {
+    std::vector<uint8_t> frame = animationFrame(f);
+    body.insert(body.end(), frame.begin(), frame.end());
+  }
+
+  uint32_t shown = framesShown, dropped = framesDropped;
+  mockBusReset();
+  unsigned long start = micros();
+  MockResponse res = server.mockRawRequest(HTTP_POST, "/animation", body.data(), body.size(),
+                                           {{"fps", "30"}, {"loop", "0"}});
+  while (animationPlaying) {
+    yield();
+  }
+  waitRender();
+  unsigned long elapsed = micros() - start;
+  unsigned long bytes = mockBus.bytes;
+  std::vector<uint16_t> played = canvasFrame();
+  bool panelOk = panelMatchesCanvas();
+
+  printf("%-22s %4d %10s %10s %10lu %10zu %5d %8lu us\n", "animation 20 @ 30 fps", res.code, "-", "-", bytes,
+         body.size(), 1, elapsed);
+  printf("%-22s %s\n", "", res.body.c_str());
+
+  std::vector<uint8_t> last = animationFrame(count - 1);
+  runRaw("draw last frame", "/draw", last.data(), last.size());
+  unsigned long drawBytes = mockBus.bytes;
+  bool lastOk = played == canvasFrame();
+  // Every frame is either shown or dropped, none past the last one
+  uint32_t counted = framesShown - shown + framesDropped - dropped;
+  printf("%-22s shown %u, dropped %u %s, %lu spi B/frame (full /draw %lu B), last frame %s\n", "",
+         (unsigned)(framesShown - shown), (unsigned)(framesDropped - dropped), check(counted == count), bytes / count,
+         drawBytes, check(lastOk && panelOk));
+
+  // Frames are drawn by palette index, also while two entries share a colour
+  uint8_t redToBlue[] = {8, 0, 0x1F, 0x00};
+  uint8_t blueToRed[] = {8, 0, 0x00, 0xF8};
+  server.mockRawRequest(HTTP_POST, "/cmd", redToBlue, sizeof(redToBlue));
+  server.mockRawRequest(HTTP_POST, "/animation", body.data(), body.size(), {{"fps", "30"}, {"loop", "0"}});
+  while (animationPlaying) {
+    yield();
+  }
+  server.mockRawRequest(HTTP_POST, "/cmd", blueToRed, sizeof(blueToRed));
+  waitRender();
+  int bar = (count - 1) % GridLayout::SIZE;
+  bool indexOk = tft.shownPixel(bar * GridLayout::CELL, 0) == ST7735_BLUE &&
+                 tft.shownPixel((bar + 2) % GridLayout::SIZE * GridLayout::CELL, 0) == ST7735_RED &&
+                 panelMatchesCanvas();
+  printf("%-22s frames drawn while entries share a colour keep their entry %s\n", "", check(indexOk));
+
+  server.mockRawRequest(HTTP_POST, "/animation", body.data(), body.size(), {{"fps", "30"}});
+  delay(200);
+  String status = server.mockRequest(HTTP_GET, "/animation/status").body;
+  bool looping = strstr(status.c_str(), "\"playing\":true") != NULL;
+  server.mockRequest(HTTP_POST, "/draw", gridArgs(2, 1));
+  waitRender();
+  bool stopped = !animationPlaying && panelMatchesCanvas();
+  int partial = server.mockRawRequest(HTTP_POST, "/animation", body.data(), body.size() - 1).code;
+  std::vector<uint8_t> huge(GridLayout::CELLS * (ANIMATION_MAX_FRAMES + 1), 1);
+  int tooMany = server.mockRawRequest(HTTP_POST, "/animation", huge.data(), huge.size()).code;
+  int noBody = server.mockRequest(HTTP_POST, "/animation", {{"fps", "30"}}).code;
+  server.mockAbortedRequest(HTTP_POST, "/animation", body.data(), GridLayout::CELLS * 2);
+  int afterAbort = server.mockRequest(HTTP_POST, "/animation", {{"fps", "30"}}).code;
+  printf("%-22s looping %s, stopped by /draw %s, partial frame %d %s, too many frames %d %s, no body %d %s, "
+         "no body after an aborted upload %d %s\n", "",
+         check(looping), check(stopped), partial, check(partial == 400), tooMany, check(tooMany == 413), noBody,
+         check(noBody == 400 && !animationPlaying), afterAbort, check(afterAbort == 400 && !animationPlaying));
+}
+
+int main() {
+  // Per request costs below, the burst runs with the real render tick
+  renderTickMs = 0;
+
+  unsigned long bootStart = micros();
+  setup();
+  unsigned long bootSetup = micros() - bootStart;
+  loop();
+  waitRender();
+  connectToWifi();
+  printf("boot: setup %lu us, reconnect uses cached channel: %s\n\n", bootSetup, check(WiFi.lastChannel, "yes", "no"));
+
+  printf("%-22s %4s %10s %10s %10s %10s %5s %11s %6s\n", "scenario", "code", "spi-trans", "windows", "spi-bytes",
+         "http-bytes", "trips", "host-time", "cells");
+  cachedEtag = run("index page", HTTP_GET, "/", {}).header("ETag");
+  run("draw sparse (16)", HTTP_POST, "/draw", gridArgs(16, 0));
+  run("draw half (128)", HTTP_POST, "/draw", gridArgs(2, 1));
+  run("draw full (256)", HTTP_POST, "/draw", gridArgs(1, 2));
+  run("draw full again", HTTP_POST, "/draw", gridArgs(1, 2));
+
+  MockArgs oneOff = gridArgs(1, 2);
+  oneOff.erase(oneOff.begin() + 17);
+  run("draw one cell off", HTTP_POST, "/draw", oneOff);
+
+  uint8_t mask[GridLayout::MASK_BYTES + 1];
+  memset(mask, 0x55, GridLayout::MASK_BYTES);
+  mask[GridLayout::MASK_BYTES] = 3;
+  runRaw("draw bitmask", "/draw", mask, sizeof(mask));
+  uint8_t cells[GridLayout::CELLS];
+  for (int i = 0; i < GridLayout::CELLS; i++) cells[i] = i % 5;
+  runRaw("draw cell colours", "/draw", cells, sizeof(cells));
+  runRaw("draw bad body", "/draw", cells, 100);
+  uint8_t badColour[GridLayout::MASK_BYTES + 1];
+  memcpy(badColour, mask, sizeof(badColour));
+  badColour[GridLayout::MASK_BYTES] = 200;
+  runRaw("draw bad colour", "/draw", badColour, sizeof(badColour));
+
+  // Undo history: states are restored by replaying deltas
+  std::vector<uint16_t> cellsFrame = canvasFrame();
+  uint32_t cellsVersion = history.version();
+  runRaw("draw bitmask", "/draw", mask, sizeof(mask));
+  std::vector<uint16_t> maskFrame = canvasFrame();
+  auto shows = [](const std::vector<uint16_t> &frame) {
+    return frame == canvasFrame() && panelMatchesCanvas();
+  };
+  run("undo", HTTP_POST, "/undo", {});
+  bool undoOk = shows(cellsFrame);
+  run("redo", HTTP_POST, "/redo", {});
+  bool redoOk = shows(maskFrame);
+  run("snapshot", HTTP_POST, (String("/snapshot/") + String((int)cellsVersion)).c_str(), {});
+  bool seekOk = shows(cellsFrame);
+  run("snapshot (dropped)", HTTP_POST, "/snapshot/100000", {});
+
+  uint8_t checkpoint[HISTORY_SAVE_SIZE];
+  size_t checkpointSize = history.save(checkpoint);
+  History restored;
+  bool loadOk = restored.load(checkpoint, checkpointSize) && restored.version() == history.version() &&
+                memcmp(restored.codes(), history.codes(), HISTORY_CELLS) == 0;
+  printf("history: versions %u..%u, deltas %zu B (full frames %u B), checkpoint %zu B, "
+         "undo %s, redo %s, snapshot %s, reload %s\n\n",
+         (unsigned)history.oldest(), (unsigned)history.newest(), history.bytesUsed(),
+         (unsigned)(history.newest() - history.oldest()) * HISTORY_CELLS, checkpointSize,
+         check(undoOk), check(redoOk), check(seekOk), check(loadOk));
+
+  // Palette change: pixels stay, the canvas recolours them at flush
+  runRaw("draw bitmask", "/draw", mask, sizeof(mask));
+  uint8_t recolour[] = {8, 3, 0x1F, 0x80};
+  runRaw("cmd palette", "/cmd", recolour, sizeof(recolour));
+  bool recolourOk = tft.shownPixel(0, 0) == 0x801F && panelMatchesCanvas();
+  uint8_t restore[] = {8, 3, 0xFF, 0xFF};
+  runRaw("cmd palette back", "/cmd", restore, sizeof(restore));
+  recolourOk = recolourOk && tft.shownPixel(0, 0) == ST7735_WHITE && panelMatchesCanvas();
+
+  // A cell drawn while two entries share a colour keeps its own entry
+  uint8_t yellow[GridLayout::CELLS] = {5};
+  runRaw("draw yellow cell", "/draw", yellow, sizeof(yellow));
+  uint8_t yellowToWhite[] = {8, 4, 0xFF, 0xFF};
+  runRaw("cmd palette", "/cmd", yellowToWhite, sizeof(yellowToWhite));
+  yellow[1] = 5;
+  runRaw("draw yellow cell", "/draw", yellow, sizeof(yellow));
+  uint8_t whiteToYellow[] = {8, 4, 0xE0, 0xFF};
+  runRaw("cmd palette back", "/cmd", whiteToYellow, sizeof(whiteToYellow));
+  bool aliasOk = tft.shownPixel(0, 0) == ST7735_YELLOW && tft.shownPixel(GridLayout::CELL, 0) == ST7735_YELLOW &&
+                 panelMatchesCanvas();
+  printf("canvas: %d bpp, %zu B framebuffer (RGB565 %d B), recolour %s, equal entries %s\n\n", CANVAS_BPP,
+         canvas.bufferSize(), canvas.width() * canvas.height() * 2, check(recolourOk), check(aliasOk));
+
+  webSocket.mockReceive(0, WStype_CONNECTED);
+  webSocket.mockReceive(1, WStype_CONNECTED);
+  uint8_t click[] = {3, 4, 1};
+  runWs("ws one cell", click, sizeof(click));
+  uint8_t drag[8 * 3];
+  for (int i = 0; i < 8; i++) {
+    drag[i * 3] = i;
+    drag[i * 3 + 1] = 10;
+    drag[i * 3 + 2] = 1;
+  }
+  runWs("ws drag (8 cells)", drag, sizeof(drag));
+
+  MockResponse events = server.mockRequest(HTTP_GET, "/screen/events");
+  WiFiClient viewer = events.peer;
+  printf("%-22s event stream open %s, server free for the next client %s\n", "", check(viewer.connected()),
+         check(!events.waitsForClose));
+  std::vector<uint16_t> mirror(canvas.width() * canvas.height());
+  size_t mirrorBytes = 0;
+  screen.poll();
+  int mirrorEvents = followScreen(viewer, mirror, mirrorBytes);
+
+  run("text", HTTP_POST, "/text", {{"text", "Hello world"}});
+  screen.poll();
+  mirrorEvents += followScreen(viewer, mirror, mirrorBytes);
+  bool mirrorOk = mirrorMatchesPanels(mirror);
+  std::string story;
+  for (int i = 0; i < 24 * PANEL_COUNT; i++) {
+    story += "word" + std::to_string(i) + (i % 5 == 4 ? " lengthier " : " ");
+  }
+  run("text long, dropped", HTTP_POST, "/text", {{"text", story.c_str()}});
+  bool droppedOk = tft.shownScroll() == 0 && textRenderer.isTruncated() && panelMatchesCanvas();
+#if PANEL_ROWS == 1
+  run("text long, scroll", HTTP_POST, "/text", {{"text", story.c_str()}, {"scroll", "1"}});
+  bool scrollOk = tft.shownScroll() == textRenderer.scrollOffset() && tft.shownScroll() != 0 && panelMatchesCanvas();
+  printf("%-22s dropped lines %s, scrolled %d rows %s\n", "", check(droppedOk),
+         textRenderer.scrollOffset(), check(scrollOk));
+
+  // Text of more commands than the render queue holds: loop() waits for
+  // room in the queue, which must not include the per-row scroll pacing
+  std::string saga;
+  while (saga.size() < 4096) {
+    saga += story;
+  }
+  unsigned long sagaStart = micros();
+  server.mockRequest(HTTP_POST, "/text", {{"text", saga.c_str()}, {"scroll", "1"}});
+  unsigned long sagaQueued = micros() - sagaStart;
+  waitRender();
+  unsigned long sagaRendered = micros() - sagaStart;
+  printf("%-22s %zu B of scrolling text queued in %lu us, rendered in %lu us %s\n", "", saga.size(), sagaQueued,
+         sagaRendered, check(sagaQueued < 1000000 && panelMatchesCanvas()));
+#else
+  // Stacked panels cannot scroll in hardware, the renderer never scrolls
+  printf("%-22s dropped lines %s, no hardware scroll with %d panel rows\n", "", check(droppedOk), PANEL_ROWS);
+#endif
+
+  // A WiFi drop after boot must leave the user's text on screen
+  std::vector<uint16_t> before = canvasFrame();
+  WiFi.mockDrop();
+  for (unsigned long until = millis() + 1200; millis() < until; delay(50)) {
+    loop();
+  }
+  WiFi.mockReconnect();
+  loop();
+  waitRender();
+  printf("%-22s wifi drop keeps the screen %s\n", "", check(before == canvasFrame() && panelMatchesCanvas()));
+
+  screen.poll();
+  mirrorEvents += followScreen(viewer, mirror, mirrorBytes);
+  mirrorOk = mirrorOk && mirrorMatchesPanels(mirror);
+  MockResponse full = server.mockRequest(HTTP_GET, "/screen");
+  viewer.mockClose();
+  screen.poll();
+  printf("%-22s mirror: %d events, %zu B fetched (frame %u B as RLE, %d B raw), match %s, closed viewer %s\n", "",
+         mirrorEvents, mirrorBytes, full.body.length(), canvas.width() * canvas.height() * 2,
+         check(mirrorOk), check(screen.viewerCount() == 0, "dropped", "KEPT"));
+  run("index page cached", HTTP_GET, "/", {}, {{"If-None-Match", cachedEtag}});
+
+  std::vector<std::vector<uint8_t>> scene = testScene();
+  std::vector<uint8_t> list;
+  for (const std::vector<uint8_t> &op : scene) {
+    list.insert(list.end(), op.begin(), op.end());
+  }
+  runRaw("cmd scene (20 ops)", "/cmd", list.data(), list.size());
+
+  mockBusReset();
+  unsigned long start = micros();
+  for (const std::vector<uint8_t> &op : scene) {
+    server.mockRawRequest(HTTP_POST, "/cmd", op.data(), op.size());
+    waitRender();
+  }
+  printf("%-22s %4d %10lu %10lu %10lu %10s %5zu %8lu us %6s\n", "cmd scene, 1 op/req", 204,
+         mockBus.transactions, mockBus.windows, mockBus.bytes, "-", scene.size(), micros() - start, "");
+  uint8_t badList[] = {1, 0, 0};
+  runRaw("cmd truncated", "/cmd", badList, sizeof(badList));
+
+  std::vector<uint16_t> eachFrame = runBurst("burst, every update", true);
+  renderTickMs = 33;
+  std::vector<uint16_t> tickFrame = runBurst("burst, 30 Hz tick", false);
+  renderTickMs = 0;
+  printf("%-22s same final frame: %s\n", "", check(eachFrame == tickFrame && panelMatchesCanvas(), "yes", "NO"));
+  animationBenchmark();
+
+  std::vector<uint8_t> rgb = testImage(128);
+  printf("\n%-8s %4s %8s %10s %10s %11s %9s %8s %6s %7s %5s\n", "image", "code", "upload", "spi-trans", "spi-bytes",
+         "host-time", "bus-ms", "kpx/s", "match", "exact", "error");
+  runImage("rgb565", encodeRgb565(rgb), rgb);
+  runImage("rle", encodeRle(rgb), rgb);
+  runImage("qoi", encodeQoi(rgb, 128, 128), rgb);
+
+  printf("\n%-16s %10s %8s %10s %11s\n", "text size 2", "chars/s", "windows", "spi-bytes", "hits/misses");
+  textBenchmark();
+
+  printf("\n%-16s %-9s %10s %10s %8s %6s\n", "flush", "path", "bus-us", "cpu-us", "fps", "match");
+  flushBenchmark("fill screen", 0);
+  flushBenchmark("16 cells", 16);
+  flushBenchmark("64 cells", 64);
+
+  printf("\n%-16s %10s %10s %10s %8s %10s %10s\n", "grid", "rect-us", "cell-us", "full-bus-us", "windows",
+         "16-bytes", "16-bus-us");
+  gridBenchmark<16>();
+  gridBenchmark<32>();
+  gridBenchmark<64>();
+  gridBenchmark<128>();
+
+  printf("\n%-16s %-9s %10s %10s %10s %10s %6s\n", "2x2 panels", "path", "switches", "trans", "windows",
+         "bus-us", "match");
+  tiledBenchmark();
+
+  bool withinBudget = replayTraces("bench/traces");
+
+  MockResponse metrics = server.mockRequest(HTTP_GET, "/metrics");
+  printf("\n/metrics: %d, %zu bytes, excerpt:\n", metrics.code, metrics.bodyBytes);
+  std::string text = metrics.body.c_str();
+  for (size_t pos = 0, end; (end = text.find('\n', pos)) != std::string::npos; pos = end + 1) {
+    std::string line = text.substr(pos, end - pos);
+    if (line.compare(0, 18, "tft_requests_total") == 0 ||
+        (line.find("route=\"/draw\"") != std::string::npos && line.find("_sum") != std::string::npos) ||
+        (line[0] != '#' && line.compare(0, 17, "tft_request_phase") != 0 && line.compare(0, 16, "tft_render_batch") != 0)) {
+      printf("  %s\n", line.c_str());
+    }
+  }
+  bool queueMetrics = strstr(metrics.body.c_str(), "tft_render_queue_depth ") != NULL &&
+                      strstr(metrics.body.c_str(), "tft_render_queue_capacity ") != NULL &&
+                      strstr(metrics.body.c_str(), "tft_render_queue_stalls_total ") != NULL &&
+                      strstr(metrics.body.c_str(), "tft_render_queue_high_water ") != NULL;
+  printf("  render queue gauges and counters %s\n", check(queueMetrics));
+
+  printf("\n");
+  bool ringOk = ringStress();
+  if (failedChecks > 0) {
+    printf("%d checks FAILED\n", failedChecks);
+  }
+  return ringOk && withinBudget && failedChecks == 0 ? 0 : 1;
+}
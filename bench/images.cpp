@@ -0,0 +1,144 @@
+/**
+ * @file images.cpp
+ * @brief Test image and encoders for the /image upload benchmark
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+/**
+ * @brief 128x128 RGB888 test picture: flat areas, a gradient and noise-like
+ *        texture, so every encoding has something to work with
+ *
+ * @param size 
+ * @return std::vector<uint8_t> 
+ */
+std::vector<uint8_t> testImage(int size) {
+  std::vector<uint8_t> rgb(size * size * 3);
+
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      uint8_t *px = &rgb[(y * size + x) * 3];
+      if (y < size / 3) {
+        px[0] = 200; px[1] = 40; px[2] = x < size / 2 ? 40 : 220;
+      } else if (y < 2 * size / 3) {
+        px[0] = x * 2; px[1] = y * 2; px[2] = 128;
+      } else {
+        px[0] = (x * 37) ^ (y * 11); px[1] = (x * y) & 0xFF; px[2] = (x + y) * 3;
+      }
+    }
+  }
+  return rgb;
+}
+
+/**
+ * @brief RGB888 to RGB565
+ *
+ * @param px 
+ * @return uint16_t 
+ */
+uint16_t toRgb565(const uint8_t *px) {
+  return ((px[0] & 0xF8) << 8) | ((px[1] & 0xFC) << 3) | (px[2] >> 3);
+}
+
+/**
+ * @brief Raw little endian RGB565
+ *
+ * @param rgb 
+ * @return std::vector<uint8_t> 
+ */
+std::vector<uint8_t> encodeRgb565(const std::vector<uint8_t> &rgb) {
+  std::vector<uint8_t> out;
+
+  for (size_t i = 0; i < rgb.size(); i += 3) {
+    uint16_t c = toRgb565(&rgb[i]);
+    out.push_back(c & 0xFF);
+    out.push_back(c >> 8);
+  }
+  return out;
+}
+
+/**
+ * @brief Runs of equal RGB565 pixels: count - 1, colour low, colour high
+ *
+ * @param rgb 
+ * @return std::vector<uint8_t> 
+ */
+std::vector<uint8_t> encodeRle(const std::vector<uint8_t> &rgb) {
+  std::vector<uint8_t> out;
+
+  for (size_t i = 0; i < rgb.size();) {
+    uint16_t c = toRgb565(&rgb[i]);
+    size_t run = 1;
+    while (run < 256 && i + run * 3 < rgb.size() && toRgb565(&rgb[i + run * 3]) == c) {
+      run++;
+    }
+    out.push_back(run - 1);
+    out.push_back(c & 0xFF);
+    out.push_back(c >> 8);
+    i += run * 3;
+  }
+  return out;
+}
+
+/**
+ * @brief QOI encoder following the reference implementation
+ *
+ * @param rgb 
+ * @param width 
+ * @param height 
+ * @return std::vector<uint8_t> 
+ */
+std::vector<uint8_t> encodeQoi(const std::vector<uint8_t> &rgb, uint32_t width, uint32_t height) {
+  std::vector<uint8_t> out = {'q', 'o', 'i', 'f'};
+  uint8_t index[64][4] = {};
+  uint8_t prev[4] = {0, 0, 0, 255};
+  int run = 0;
+
+  for (int shift = 24; shift >= 0; shift -= 8) out.push_back(width >> shift);
+  for (int shift = 24; shift >= 0; shift -= 8) out.push_back(height >> shift);
+  out.push_back(3);
+  out.push_back(0);
+
+  size_t count = (size_t)width * height;
+  for (size_t i = 0; i < count; i++) {
+    uint8_t px[4] = {rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2], 255};
+
+    if (memcmp(px, prev, 4) == 0) {
+      run++;
+      if (run == 62 || i == count - 1) {
+        out.push_back(0xC0 | (run - 1));
+        run = 0;
+      }
+      continue;
+    }
+    if (run > 0) {
+      out.push_back(0xC0 | (run - 1));
+      run = 0;
+    }
+
+    int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+    if (memcmp(index[hash], px, 4) == 0) {
+      out.push_back(hash);
+    } else {
+      memcpy(index[hash], px, 4);
+      int8_t vr = px[0] - prev[0], vg = px[1] - prev[1], vb = px[2] - prev[2];
+      int8_t vgr = vr - vg, vgb = vb - vg;
+      if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+        out.push_back(0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+      } else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+        out.push_back(0x80 | (vg + 32));
+        out.push_back((vgr + 8) << 4 | (vgb + 8));
+      } else {
+        out.push_back(0xFE);
+        out.insert(out.end(), px, px + 3);
+      }
+    }
+    memcpy(prev, px, 4);
+  }
+
+  for (int i = 0; i < 7; i++) out.push_back(0);
+  out.push_back(1);
+  return out;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file Adafruit_SPITFT.h
+ * @brief Host stand-in for Adafruit_SPITFT that models SPI bus traffic
+ *
+ * Every pixel that reaches the "panel" is stored in a shadow frame so the
+ * benchmark can compare rendering paths, and every transaction, address
+ * window and byte is counted in mockBus together with a modelled bus time.
+ *
+ * Timing model of the Arduino SPI driver on the ESP32: bytes take 8 clock
+ * cycles, each transaction (CS cycle, bus lock) costs MOCK_TRANSACTION_NS
+ * and bulk writes pause MOCK_FIFO_GAP_NS every 64 bytes while the CPU
+ * refills the hardware FIFO. The CPU is busy for the whole bus time.
+ */
+
+#ifndef MOCK_ADAFRUIT_SPITFT_H
+#define MOCK_ADAFRUIT_SPITFT_H
+
+#include <vector>
+#include "Adafruit_GFX.h"
+
+// CASET + 4 bytes, RASET + 4 bytes, RAMWR
+#define MOCK_ADDR_WINDOW_BYTES 11
+#define MOCK_TRANSACTION_NS 2000
+#define MOCK_FIFO_GAP_NS 500
+#define MOCK_FIFO_BYTES 64
+#define MOCK_DEFAULT_SPI_FREQ 27000000
+
+// RAM offset of the 128x128 green tab panel and its vertical scroll start command
+#define MOCK_PANEL_XSTART 2
+#define MOCK_PANEL_YSTART 3
+#define MOCK_VSCRSADD 0x37
+
+struct MockBus {
+  unsigned long transactions;
+  unsigned long windows;
+  unsigned long bytes;
+  double busNanos;  // time the bus is occupied
+  double cpuNanos;  // time the CPU is blocked by the bus
+  unsigned long panelSwitches;  // transfers addressed to another panel than the one before
+};
+
+extern MockBus mockBus;
+
+void mockBusReset();
+
+class Adafruit_SPITFT;
+
+/** Count a panel switch when traffic goes to another panel than before */
+void mockSelect(const Adafruit_SPITFT *panel);
+
+/** Panel wired to the chip select pin, used by the ESP-IDF SPI stand-in */
+Adafruit_SPITFT *mockPanel(int8_t cs);
+void mockRegisterPanel(int8_t cs, Adafruit_SPITFT *panel);
+void mockRegisterDcPin(int8_t cs, int8_t dc);
+
+class Adafruit_SPITFT : public Adafruit_GFX {
+public:
+  Adafruit_SPITFT(uint16_t w, uint16_t h)
+      : Adafruit_GFX(w, h), freq(MOCK_DEFAULT_SPI_FREQ), frame((size_t)w * h, 0), depth(0),
+        winX(0), winY(0), winW(0), winH(0), winPos(0), scroll(0) {}
+
+  void setSPISpeed(uint32_t f) { freq = f; }
+  uint32_t spiSpeed() const { return freq; }
+
+  void startWrite() override {
+    if (depth++ == 0) {
+      mockSelect(this);
+      mockBus.transactions++;
+      blocking(MOCK_TRANSACTION_NS);
+    }
+  }
+  void endWrite() override {
+    if (depth > 0) depth--;
+  }
+
+  virtual void setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    mockWindow(x, y, w, h);
+    mockBus.windows++;
+    send(MOCK_ADDR_WINDOW_BYTES);
+  }
+
+  void writePixels(uint16_t *colors, uint32_t len, bool block = true, bool bigEndian = false) {
+    (void)block; (void)bigEndian;
+    send(len * 2);
+    blocking((double)(len * 2 / MOCK_FIFO_BYTES) * MOCK_FIFO_GAP_NS);
+    while (len--) mockPixel(*colors++);
+  }
+  void writeColor(uint16_t color, uint32_t len) {
+    send(len * 2);
+    blocking((double)(len * 2 / MOCK_FIFO_BYTES) * MOCK_FIFO_GAP_NS);
+    while (len--) mockPixel(color);
+  }
+  void dmaWait() {}
+
+  void sendCommand(uint8_t commandByte, const uint8_t *dataBytes, uint8_t numDataBytes) {
+    startWrite();
+    send(1 + numDataBytes);
+    endWrite();
+    if (commandByte == MOCK_VSCRSADD && numDataBytes == 2) {
+      mockScroll(((dataBytes[0] << 8) | dataBytes[1]) - MOCK_PANEL_YSTART);
+    }
+  }
+
+  void writePixel(int16_t x, int16_t y, uint16_t color) override {
+    if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+    setAddrWindow(x, y, 1, 1);
+    send(2);
+    mockPixel(color);
+  }
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+    startWrite();
+    writePixel(x, y, color);
+    endWrite();
+  }
+  void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > _width) w = _width - x;
+    if (y + h > _height) h = _height - y;
+    if (w <= 0 || h <= 0) return;
+    setAddrWindow(x, y, w, h);
+    writeColor(color, (uint32_t)w * h);
+  }
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override {
+    startWrite();
+    writeFillRect(x, y, w, h, color);
+    endWrite();
+  }
+  void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override { writeFillRect(x, y, 1, h, color); }
+  void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override { writeFillRect(x, y, w, 1, color); }
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override { fillRect(x, y, 1, h, color); }
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override { fillRect(x, y, w, 1, color); }
+
+  /** Pixel currently shown by the mock panel, RAM rows are shifted by the vertical scroll */
+  uint16_t shownPixel(int16_t x, int16_t y) const { return frame[(size_t)((y + scroll) % HEIGHT) * WIDTH + x]; }
+  int16_t shownScroll() const { return scroll; }
+
+  /** Panel side of the bus: set the RAM window / store the next pixel, without cost accounting */
+  void mockWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    winX = x; winY = y; winW = w; winH = h; winPos = 0;
+  }
+  void mockScroll(int16_t rows) {
+    scroll = ((rows % HEIGHT) + HEIGHT) % HEIGHT;
+  }
+  void mockPixel(uint16_t color) {
+    if (winW == 0 || winH == 0) return;
+    uint32_t px = winX + winPos % winW;
+    uint32_t py = winY + (winPos / winW) % winH;
+    winPos++;
+    if (px < (uint32_t)WIDTH && py < (uint32_t)HEIGHT) frame[py * WIDTH + px] = color;
+  }
+
+protected:
+  void send(uint32_t bytes) {
+    mockBus.bytes += bytes;
+    blocking(bytes * 8e9 / freq);
+  }
+  static void blocking(double nanos) {
+    mockBus.busNanos += nanos;
+    mockBus.cpuNanos += nanos;
+  }
+
+  uint32_t freq;
+  std::vector<uint16_t> frame;
+  int depth;
+  uint16_t winX, winY, winW, winH;
+  uint32_t winPos;
+  int16_t scroll;
+};
+
+#endif
@@ -0,0 +1,53 @@
+/**
+ * @file Adafruit_ST7735.h
+ * @brief Host stand-in for the ST7735 driver
+ */
+
+#ifndef MOCK_ADAFRUIT_ST7735_H
+#define MOCK_ADAFRUIT_ST7735_H
+
+#include "Adafruit_SPITFT.h"
+
+#define INITR_GREENTAB 0x00
+#define INITR_REDTAB 0x01
+#define INITR_BLACKTAB 0x02
+#define INITR_144GREENTAB 0x01
+
+#define ST77XX_CASET 0x2A
+#define ST77XX_RASET 0x2B
+#define ST77XX_RAMWR 0x2C
+
+#define ST77XX_BLACK 0x0000
+#define ST77XX_WHITE 0xFFFF
+#define ST77XX_RED 0xF800
+#define ST77XX_GREEN 0x07E0
+#define ST77XX_BLUE 0x001F
+#define ST77XX_CYAN 0x07FF
+#define ST77XX_MAGENTA 0xF81F
+#define ST77XX_YELLOW 0xFFE0
+#define ST77XX_ORANGE 0xFC00
+
+#define ST7735_BLACK ST77XX_BLACK
+#define ST7735_WHITE ST77XX_WHITE
+#define ST7735_RED ST77XX_RED
+#define ST7735_GREEN ST77XX_GREEN
+#define ST7735_BLUE ST77XX_BLUE
+#define ST7735_CYAN ST77XX_CYAN
+#define ST7735_MAGENTA ST77XX_MAGENTA
+#define ST7735_YELLOW ST77XX_YELLOW
+#define ST7735_ORANGE ST77XX_ORANGE
+
+class Adafruit_ST7735 : public Adafruit_SPITFT {
+public:
+  Adafruit_ST7735(int8_t cs, int8_t dc, int8_t rst)
+      : Adafruit_SPITFT(128, 128), cs(cs), dc(dc), rst(rst) {
+    mockRegisterPanel(cs, this);
+    mockRegisterDcPin(cs, dc);
+  }
+
+  void initR(uint8_t options = INITR_GREENTAB) { (void)options; }
+
+  const int8_t cs, dc, rst;
+};
+
+#endif
@@ -0,0 +1,48 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal host stand-in for the Arduino core used by the native benchmark build
+ */
+
+#ifndef MOCK_ARDUINO_H
+#define MOCK_ARDUINO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "WString.h"
+#include "Print.h"
+#include "Esp.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define PROGMEM
+#define IRAM_ATTR
+#define PGM_P const char *
+#define F(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t size) override;
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif
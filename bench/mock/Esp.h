@@ -0,0 +1,24 @@
+/**
+ * @file Esp.h
+ * @brief Host stand-in for the ESP32 system class
+ *
+ * The cycle counter runs at the nominal 240 MHz off the host clock; the heap
+ * figures are constants of a typical Arduino build with WiFi up.
+ */
+
+#ifndef MOCK_ESP_H
+#define MOCK_ESP_H
+
+#include <stdint.h>
+
+class EspClass {
+public:
+  uint32_t getCycleCount();
+  uint32_t getCpuFreqMHz() { return 240; }
+  uint32_t getFreeHeap() { return 215000; }
+  uint32_t getMinFreeHeap() { return 198000; }
+};
+
+extern EspClass ESP;
+
+#endif
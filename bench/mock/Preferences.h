@@ -0,0 +1,33 @@
+/**
+ * @file Preferences.h
+ * @brief Host stand-in for the ESP32 NVS key-value store, kept in memory
+ */
+
+#ifndef MOCK_PREFERENCES_H
+#define MOCK_PREFERENCES_H
+
+#include <Arduino.h>
+
+class Preferences {
+public:
+  bool begin(const char *name, bool readOnly = false, const char *partition_label = NULL);
+  void end() { opened = false; }
+
+  size_t getBytes(const char *key, void *buf, size_t maxLen);
+  size_t putBytes(const char *key, const void *value, size_t len);
+  uint8_t getUChar(const char *key, uint8_t defaultValue = 0);
+  size_t putUChar(const char *key, uint8_t value) { return putBytes(key, &value, sizeof(value)); }
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0);
+  size_t putUInt(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+  bool remove(const char *key);
+
+  // Number of put calls since start, one flash write each on the device
+  static unsigned long writes;
+
+private:
+  String space;
+  bool opened = false;
+  bool readOnly = true;
+};
+
+#endif
@@ -0,0 +1,22 @@
+/**
+ * @file SPI.h
+ * @brief Host stand-in for the Arduino SPI library (bus traffic is modelled in Adafruit_SPITFT.h
+ *        and driver/spi_master.h)
+ */
+
+#ifndef MOCK_SPI_H
+#define MOCK_SPI_H
+
+#include <Arduino.h>
+
+class SPIClass {
+public:
+  void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {
+    (void)sck; (void)miso; (void)mosi; (void)ss;
+  }
+  void end() {}
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,23 @@
+/**
+ * @file Uri.h
+ * @brief Host stand-in for the route pattern classes of the ESP32 WebServer
+ */
+
+#ifndef MOCK_URI_H
+#define MOCK_URI_H
+
+#include "WString.h"
+
+class Uri {
+public:
+  Uri(const char *uri) : uri(uri) {}
+  Uri(const String &uri) : uri(uri) {}
+  virtual ~Uri() {}
+
+  /** "{}" in the pattern matches one path segment */
+  virtual bool hasBraces() const { return false; }
+
+  String uri;
+};
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * @file WString.h
+ * @brief Host stand-in for the Arduino String class
+ */
+
+#ifndef MOCK_WSTRING_H
+#define MOCK_WSTRING_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+class String {
+public:
+  String() {}
+  String(const char *s) : s(s ? s : "") {}
+  String(const std::string &s) : s(s) {}
+  String(char c) : s(1, c) {}
+  String(int v) : s(std::to_string(v)) {}
+  String(unsigned int v) : s(std::to_string(v)) {}
+  String(long v) : s(std::to_string(v)) {}
+  String(unsigned long v) : s(std::to_string(v)) {}
+
+  const char *c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.length(); }
+  long toInt() const { return strtol(s.c_str(), NULL, 10); }
+  bool isEmpty() const { return s.empty(); }
+  bool equals(const String &o) const { return s == o.s; }
+  bool startsWith(const String &o) const { return s.compare(0, o.s.size(), o.s) == 0; }
+  int indexOf(char c, unsigned int from = 0) const {
+    size_t i = s.find(c, from);
+    return i == std::string::npos ? -1 : (int)i;
+  }
+  String substring(unsigned int from) const { return from < s.size() ? String(s.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    return from < s.size() && to > from ? String(s.substr(from, to - from)) : String();
+  }
+  void toCharArray(char *buf, unsigned int size) const {
+    if (!size) return;
+    strncpy(buf, s.c_str(), size - 1);
+    buf[size - 1] = '\0';
+  }
+  char operator[](unsigned int i) const { return i < s.size() ? s[i] : 0; }
+
+  String &operator+=(const String &o) { s += o.s; return *this; }
+  String &operator+=(const char *o) { s += o; return *this; }
+  String &operator+=(char c) { s += c; return *this; }
+  friend String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+  friend String operator+(const String &a, const char *b) { return String(a.s + b); }
+  friend String operator+(const char *a, const String &b) { return String(a + b.s); }
+  bool operator==(const String &o) const { return s == o.s; }
+  bool operator==(const char *o) const { return s == o; }
+  bool operator!=(const String &o) const { return s != o.s; }
+  bool operator<(const String &o) const { return s < o.s; }
+
+private:
+  std::string s;
+};
+
+#endif
@@ -0,0 +1,132 @@
+/**
+ * @file WebServer.h
+ * @brief Host stand-in for the ESP32 WebServer
+ *
+ * Routes are registered exactly like on the device. Instead of a socket,
+ * the benchmark feeds requests through mockRequest() and inspects the
+ * recorded MockResponse.
+ */
+
+#ifndef MOCK_WEBSERVER_H
+#define MOCK_WEBSERVER_H
+
+#include <functional>
+#include <utility>
+#include <vector>
+#include <Arduino.h>
+#include <WiFi.h>
+#include "Uri.h"
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+
+#define HTTP_RAW_BUFLEN 1436
+
+enum HTTPRawStatus { RAW_START, RAW_WRITE, RAW_END, RAW_ABORTED };
+
+struct HTTPRaw {
+  HTTPRawStatus status;
+  size_t totalSize;
+  size_t currentSize;
+  uint8_t buf[HTTP_RAW_BUFLEN];
+  void *data;
+};
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+typedef std::vector<std::pair<String, String>> MockArgs;
+
+struct MockResponse {
+  int code;
+  size_t headerBytes;
+  size_t bodyBytes;
+  String body;
+  MockArgs headers;
+  WiFiClient peer;           // browser end of the connection
+  bool waitsForClose = false; // handler left the connection open without a response,
+                              // the real server then waits HTTP_MAX_CLOSE_WAIT for the browser
+
+  String header(const String &name) const;
+};
+
+class WebServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  WebServer(int port = 80) : port(port) {}
+
+  void begin() {}
+  void handleClient() {}
+
+  void on(const Uri &uri, THandlerFunction fn) { on(uri, HTTP_ANY, fn); }
+  void on(const Uri &uri, HTTPMethod method, THandlerFunction fn) { on(uri, method, fn, nullptr); }
+  void on(const Uri &uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn) {
+    routes.push_back({uri.uri, uri.hasBraces(), method, fn, ufn});
+  }
+  void onNotFound(THandlerFunction fn) { notFound = fn; }
+
+  String uri() const { return currentUri; }
+  HTTPMethod method() const { return currentMethod; }
+  int args() const { return currentArgs.size(); }
+  String arg(int i) const { return i < args() ? currentArgs[i].second : String(); }
+  String argName(int i) const { return i < args() ? currentArgs[i].first : String(); }
+  String pathArg(unsigned int i) const { return i < pathArgs.size() ? pathArgs[i] : String(); }
+  String arg(const String &name) const;
+  bool hasArg(const String &name) const;
+  HTTPRaw &raw() { return currentRaw; }
+  WiFiClient &client() { return currentClient; }
+  void collectHeaders(const char *headerKeys[], const size_t headerKeysCount) { (void)headerKeys; (void)headerKeysCount; }
+  String header(const String &name) const;
+  bool hasHeader(const String &name) const;
+
+  void sendHeader(const String &name, const String &value, bool first = false);
+  void send(int code, const char *content_type = NULL, const String &content = String(""));
+  void send(int code, const String &content_type, const String &content) { send(code, content_type.c_str(), content); }
+  void setContentLength(const size_t contentLength);
+  void sendContent(const char *content, size_t contentLength);
+  void sendContent(const String &content);
+  void send_P(int code, PGM_P content_type, PGM_P content);
+  void send_P(int code, PGM_P content_type, PGM_P content, size_t contentLength);
+
+  /** Dispatch one request to the registered handler and return what it sent */
+  MockResponse mockRequest(HTTPMethod method, const String &uri, const MockArgs &args = MockArgs(),
+                           const MockArgs &headers = MockArgs());
+
+  /** Dispatch a request with a non-form body, streamed to the raw handler like the real server does */
+  MockResponse mockRawRequest(HTTPMethod method, const String &uri, const uint8_t *body, size_t length,
+                              const MockArgs &args = MockArgs());
+
+  /** Stream part of a raw body, then drop the connection: the raw handler sees RAW_ABORTED and the request
+   *  handler is not called */
+  void mockAbortedRequest(HTTPMethod method, const String &uri, const uint8_t *body, size_t length);
+
+private:
+  struct Route {
+    String uri;
+    bool braces;
+    HTTPMethod method;
+    THandlerFunction fn;
+    THandlerFunction ufn;
+  };
+
+  const Route *findRoute(HTTPMethod method, const String &uri);
+  bool matchBraces(const String &pattern, const String &uri);
+  void begin(HTTPMethod method, const String &uri, const MockArgs &args, const MockArgs &headers);
+  void streamRaw(const Route *route, const uint8_t *body, size_t length);
+
+  void respond(int code, const char *content_type, size_t length);
+
+  int port;
+  std::vector<Route> routes;
+  THandlerFunction notFound;
+  String currentUri;
+  HTTPMethod currentMethod;
+  MockArgs currentArgs;
+  std::vector<String> pathArgs;
+  MockArgs currentHeaders;
+  HTTPRaw currentRaw;
+  WiFiClient currentClient;
+  MockArgs pendingHeaders;
+  MockResponse response;
+};
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file WebSocketsServer.h
+ * @brief Host stand-in for the links2004 WebSocketsServer
+ *
+ * Frames are injected with mockReceive(); everything the firmware sends is
+ * only counted.
+ */
+
+#ifndef MOCK_WEBSOCKETSSERVER_H
+#define MOCK_WEBSOCKETSSERVER_H
+
+#include <functional>
+#include <Arduino.h>
+
+typedef enum {
+  WStype_ERROR,
+  WStype_DISCONNECTED,
+  WStype_CONNECTED,
+  WStype_TEXT,
+  WStype_BIN,
+  WStype_PING,
+  WStype_PONG,
+} WStype_t;
+
+class WebSocketsServer {
+public:
+  typedef std::function<void(uint8_t num, WStype_t type, uint8_t *payload, size_t length)> WebSocketServerEvent;
+
+  WebSocketsServer(uint16_t port) : port(port), clients(0), sentFrames(0), sentBytes(0) {}
+
+  void begin() {}
+  void loop() {}
+  void onEvent(WebSocketServerEvent cbEvent) { event = cbEvent; }
+  uint8_t connectedClients(bool ping = false) { (void)ping; return clients; }
+
+  bool sendBIN(uint8_t num, const uint8_t *payload, size_t length) {
+    (void)num; (void)payload;
+    sentFrames++;
+    sentBytes += length + 4;
+    return true;
+  }
+  bool broadcastBIN(const uint8_t *payload, size_t length) {
+    (void)payload;
+    sentFrames += clients;
+    sentBytes += (length + 4) * clients;
+    return clients > 0;
+  }
+
+  /** Deliver one event to the firmware as if a client sent it */
+  void mockReceive(uint8_t num, WStype_t type, uint8_t *payload = NULL, size_t length = 0) {
+    if (type == WStype_CONNECTED) clients++;
+    if (type == WStype_DISCONNECTED && clients > 0) clients--;
+    if (event) event(num, type, payload, length);
+  }
+
+  uint16_t port;
+  uint8_t clients;
+  unsigned long sentFrames;
+  unsigned long sentBytes;
+
+private:
+  WebSocketServerEvent event;
+};
+
+#endif
@@ -0,0 +1,154 @@
+/**
+ * @file WiFi.h
+ * @brief Host stand-in for the ESP32 WiFi library; association succeeds
+ *        immediately and is reported through the event callback
+ */
+
+#ifndef MOCK_WIFI_H
+#define MOCK_WIFI_H
+
+#include <memory>
+#include <string>
+#include <Arduino.h>
+
+typedef enum { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA } wifi_mode_t;
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+typedef enum {
+  ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+  ARDUINO_EVENT_MAX = 100,
+} arduino_event_id_t;
+
+typedef void (*WiFiEventCb)(arduino_event_id_t event);
+
+class IPAddress {
+public:
+  IPAddress() : IPAddress(0, 0, 0, 0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address(a | b << 8 | c << 16 | (uint32_t)d << 24) {}
+  IPAddress(uint32_t address) : address(address) {}
+  operator uint32_t() const { return address; }
+  String toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", address & 0xFF, (address >> 8) & 0xFF, (address >> 16) & 0xFF,
+             address >> 24);
+    return String(buf);
+  }
+
+private:
+  uint32_t address;
+};
+
+/**
+ * @brief Connection to a client; copies share the socket like on the device,
+ *        where stop() drops one handle and the last handle closes the
+ *        socket. What the firmware writes is kept for the benchmark to read.
+ */
+class WiFiClient : public Print {
+public:
+  WiFiClient() {}
+  WiFiClient(const WiFiClient &other) { *this = other; }
+  WiFiClient &operator=(const WiFiClient &other) {
+    if (this != &other) {
+      release();
+      socket = other.socket;
+      peer = other.peer;
+      if (socket && !peer) socket->handles++;
+    }
+    return *this;
+  }
+  ~WiFiClient() { release(); }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t size) override {
+    if (!connected()) return 0;
+    socket->sent.append((const char *)buf, size);
+    return size;
+  }
+  uint8_t connected() { return socket && socket->open; }
+  void stop() { release(); }
+  explicit operator bool() { return connected(); }
+
+  /** Open a new connection, as accepted by the server */
+  static WiFiClient mockAccept() {
+    WiFiClient client;
+    client.socket = std::make_shared<Socket>();
+    return client;
+  }
+  /** Browser end of the connection, does not keep the socket open */
+  WiFiClient mockPeer() const {
+    WiFiClient client;
+    client.socket = socket;
+    client.peer = true;
+    return client;
+  }
+  /** Bytes written since the last call */
+  std::string mockTake() {
+    std::string out;
+    if (socket) out.swap(socket->sent);
+    return out;
+  }
+  /** Peer closes the connection */
+  void mockClose() {
+    if (socket) socket->open = false;
+  }
+
+private:
+  struct Socket {
+    bool open = true;
+    int handles = 1;
+    std::string sent;
+  };
+
+  void release() {
+    if (socket && !peer && --socket->handles == 0) socket->open = false;
+    socket.reset();
+  }
+
+  std::shared_ptr<Socket> socket;
+  bool peer = false;
+};
+
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t m) { (void)m; return true; }
+  void onEvent(WiFiEventCb cb, arduino_event_id_t event = ARDUINO_EVENT_MAX) { (void)event; callback = cb; }
+  wl_status_t begin(const char *ssid, const char *pass, int32_t channel = 0, const uint8_t *bssid = NULL,
+                    bool connect = true);
+  bool config(IPAddress ip, IPAddress gateway, IPAddress subnet, IPAddress dns) {
+    (void)gateway; (void)subnet; (void)dns;
+    staticIp = ip;
+    return true;
+  }
+  bool disconnect() { connected = false; return true; }
+  wl_status_t status() { return connected ? WL_CONNECTED : WL_DISCONNECTED; }
+  IPAddress localIP() { return IPAddress(192, 168, 4, 2); }
+  IPAddress gatewayIP() { return IPAddress(192, 168, 4, 1); }
+  IPAddress subnetMask() { return IPAddress(255, 255, 255, 0); }
+  IPAddress dnsIP() { return IPAddress(192, 168, 4, 1); }
+  uint8_t *BSSID() { return bssid; }
+  int32_t channel() { return 6; }
+
+  // Connection lost and regained later, reported like the event task does
+  void mockDrop() {
+    connected = false;
+    if (callback) callback(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+  }
+  void mockReconnect() {
+    connected = true;
+    if (callback) callback(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  }
+
+  // Channel given to the last begin(), 0 when it scanned
+  int32_t lastChannel = 0;
+
+private:
+  WiFiEventCb callback = NULL;
+  bool connected = false;
+  IPAddress staticIp;
+  uint8_t bssid[6] = {0x24, 0x0a, 0xc4, 0x12, 0x34, 0x56};
+};
+
+extern WiFiClass WiFi;
+
+#endif
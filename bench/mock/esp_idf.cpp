@@ -0,0 +1,180 @@
+/**
+ * @file esp_idf.cpp
+ * @brief Implementation of the ESP-IDF SPI master and GPIO stand-ins
+ */
+
+#include <deque>
+#include <map>
+#include <Adafruit_ST7735.h>
+#include <driver/gpio.h>
+#include <driver/spi_master.h>
+
+// Offset of the 128x128 area in controller RAM on the 1.44" green tab
+
+struct spi_device_t {
+  int cs;
+  int clock;
+  transaction_cb_t pre_cb;
+  std::deque<spi_transaction_t *> done;
+  // ST77xx decoder state
+  uint8_t command;
+  uint8_t params[4];
+  int paramCount;
+  uint16_t caset[2];
+  uint16_t raset[2];
+  int pixelByte;
+  uint8_t pixelHigh;
+};
+
+// Function statics: panels register themselves from global constructors
+static std::map<int, Adafruit_SPITFT *> &panels() {
+  static std::map<int, Adafruit_SPITFT *> map;
+  return map;
+}
+
+static std::map<int, int> &dcPins() {
+  static std::map<int, int> map;
+  return map;
+}
+
+static std::map<int, uint32_t> levels;
+
+// CS pin of a registered panel driven low last, for devices without a CS of their own
+static int selectedCs = -1;
+
+Adafruit_SPITFT *mockPanel(int8_t cs) {
+  auto it = panels().find(cs);
+  return it == panels().end() ? nullptr : it->second;
+}
+
+void mockRegisterPanel(int8_t cs, Adafruit_SPITFT *panel) {
+  panels()[cs] = panel;
+}
+
+void mockRegisterDcPin(int8_t cs, int8_t dc) {
+  dcPins()[cs] = dc;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t mode) {
+  (void)gpio; (void)mode;
+  return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level) {
+  levels[gpio] = level;
+  if (level == 0 && mockPanel(gpio)) {
+    selectedCs = gpio;
+  }
+  return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio) {
+  return levels[gpio];
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t *bus_config, int dma_chan) {
+  (void)host; (void)bus_config; (void)dma_chan;
+  return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *dev_config,
+                             spi_device_handle_t *handle) {
+  (void)host;
+  spi_device_t *dev = new spi_device_t();
+  dev->cs = dev_config->spics_io_num;
+  dev->clock = dev_config->clock_speed_hz;
+  dev->pre_cb = dev_config->pre_cb;
+  *handle = dev;
+  return ESP_OK;
+}
+
+/**
+ * @brief Feed one byte to the emulated ST77xx controller
+ *
+ * @param dev 
+ * @param byte 
+ * @param data DC level, high for data
+ */
+static void decode(spi_device_t *dev, uint8_t byte, bool data) {
+  Adafruit_SPITFT *panel = mockPanel(dev->cs >= 0 ? dev->cs : selectedCs);
+
+  if (!data) {
+    dev->command = byte;
+    dev->paramCount = 0;
+    dev->pixelByte = 0;
+    if (byte == ST77XX_RAMWR && panel) {
+      panel->mockWindow(dev->caset[0] - MOCK_PANEL_XSTART, dev->raset[0] - MOCK_PANEL_YSTART,
+                        dev->caset[1] - dev->caset[0] + 1, dev->raset[1] - dev->raset[0] + 1);
+      mockBus.windows++;
+    }
+    return;
+  }
+
+  if (dev->command == MOCK_VSCRSADD) {
+    if (dev->paramCount < 4) dev->params[dev->paramCount++] = byte;
+    if (dev->paramCount == 2 && panel) {
+      panel->mockScroll(((dev->params[0] << 8) | dev->params[1]) - MOCK_PANEL_YSTART);
+    }
+  } else if (dev->command == ST77XX_CASET || dev->command == ST77XX_RASET) {
+    if (dev->paramCount < 4) dev->params[dev->paramCount++] = byte;
+    if (dev->paramCount == 4) {
+      uint16_t *range = dev->command == ST77XX_CASET ? dev->caset : dev->raset;
+      range[0] = (dev->params[0] << 8) | dev->params[1];
+      range[1] = (dev->params[2] << 8) | dev->params[3];
+    }
+  } else if (dev->command == ST77XX_RAMWR) {
+    if (dev->pixelByte++ & 1) {
+      if (panel) panel->mockPixel((dev->pixelHigh << 8) | byte);
+    } else {
+      dev->pixelHigh = byte;
+    }
+  }
+}
+
+/**
+ * @brief Run a transaction through the decoder and account its bus time
+ *
+ * @param dev 
+ * @param trans 
+ * @param polling CPU waits for the transfer
+ */
+static void transfer(spi_device_t *dev, spi_transaction_t *trans, bool polling) {
+  if (dev->pre_cb) dev->pre_cb(trans);
+
+  int cs = dev->cs >= 0 ? dev->cs : selectedCs;
+  mockSelect(mockPanel(cs));
+
+  auto dc = dcPins().find(cs);
+  bool data = dc != dcPins().end() && levels[dc->second];
+  size_t bytes = trans->length / 8;
+  const uint8_t *tx = (trans->flags & SPI_TRANS_USE_TXDATA) ? trans->tx_data : (const uint8_t *)trans->tx_buffer;
+
+  for (size_t i = 0; i < bytes; i++) decode(dev, tx[i], data);
+
+  double nanos = bytes * 8e9 / dev->clock + MOCK_TRANSACTION_NS;
+  mockBus.transactions++;
+  mockBus.bytes += bytes;
+  mockBus.busNanos += nanos;
+  mockBus.cpuNanos += polling ? nanos : MOCK_TRANSACTION_NS;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans, TickType_t ticks_to_wait) {
+  (void)ticks_to_wait;
+  transfer(handle, trans, false);
+  handle->done.push_back(trans);
+  return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans_desc,
+                                      TickType_t ticks_to_wait) {
+  (void)ticks_to_wait;
+  if (handle->done.empty()) return ESP_ERR_TIMEOUT;
+  *trans_desc = handle->done.front();
+  handle->done.pop_front();
+  return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans) {
+  transfer(handle, trans, true);
+  return ESP_OK;
+}
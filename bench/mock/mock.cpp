@@ -0,0 +1,374 @@
+/**
+ * @file mock.cpp
+ * @brief Implementation of the host stand-ins for the Arduino/ESP32 APIs
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <map>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <Adafruit_SPITFT.h>
+#include <Preferences.h>
+#include <SPI.h>
+#include <WebServer.h>
+#include <WiFi.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+SPIClass SPI;
+WiFiClass WiFi;
+MockBus mockBus;
+
+static const auto bootTime = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+uint32_t EspClass::getCycleCount() {
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - bootTime).count();
+  return (uint32_t)(ns * getCpuFreqMHz() / 1000);
+}
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield() {
+  std::this_thread::yield();
+}
+
+struct MockTask {
+  std::mutex lock;
+  std::condition_variable wake;
+  uint32_t notifications = 0;
+};
+
+static thread_local MockTask *currentTask = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *param,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+  (void)name; (void)stackDepth; (void)priority; (void)core;
+  MockTask *task = new MockTask();
+  if (handle) {
+    *handle = task;
+  }
+  std::thread([fn, param, task]() {
+    currentTask = task;
+    fn(param);
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  if (!task) return pdFALSE;
+  std::lock_guard<std::mutex> guard(task->lock);
+  task->notifications++;
+  task->wake.notify_one();
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+  MockTask *task = currentTask;
+  if (!task) return 0;
+  std::unique_lock<std::mutex> guard(task->lock);
+  auto ready = [task]() { return task->notifications > 0; };
+  if (ticksToWait == portMAX_DELAY)
+    task->wake.wait(guard, ready);
+  else
+    task->wake.wait_for(guard, std::chrono::milliseconds(ticksToWait), ready);
+  uint32_t value = task->notifications;
+  if (value) task->notifications = clearOnExit ? 0 : value - 1;
+  return value;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  delay(ticks);
+}
+
+void vTaskDelayUntil(TickType_t *previousWakeTime, TickType_t timeIncrement) {
+  TickType_t target = *previousWakeTime + timeIncrement;
+  TickType_t now = millis();
+  if ((int32_t)(target - now) > 0) delay(target - now);
+  *previousWakeTime = target;
+}
+
+TickType_t xTaskGetTickCount() {
+  return millis();
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return fwrite(&c, 1, 1, stderr);
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t size) {
+  return fwrite(buf, 1, size, stderr);
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *pass, int32_t channel, const uint8_t *bssid,
+                              bool connect) {
+  (void)ssid; (void)pass; (void)bssid;
+  lastChannel = channel;
+  connected = connect;
+  if (connected && callback) {
+    callback(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+    callback(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  }
+  return status();
+}
+
+unsigned long Preferences::writes = 0;
+
+static std::map<std::string, std::vector<uint8_t>> &nvs() {
+  static std::map<std::string, std::vector<uint8_t>> store;
+  return store;
+}
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partition_label) {
+  (void)partition_label;
+  space = name;
+  this->readOnly = readOnly;
+  opened = true;
+  return true;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+  auto item = nvs().find(std::string(space.c_str()) + "/" + key);
+  if (!opened || item == nvs().end() || item->second.size() > maxLen) return 0;
+  memcpy(buf, item->second.data(), item->second.size());
+  return item->second.size();
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+  if (!opened || readOnly) return 0;
+  nvs()[std::string(space.c_str()) + "/" + key].assign((const uint8_t *)value, (const uint8_t *)value + len);
+  writes++;
+  return len;
+}
+
+uint8_t Preferences::getUChar(const char *key, uint8_t defaultValue) {
+  uint8_t value = defaultValue;
+  getBytes(key, &value, sizeof(value));
+  return value;
+}
+
+uint32_t Preferences::getUInt(const char *key, uint32_t defaultValue) {
+  uint32_t value = defaultValue;
+  getBytes(key, &value, sizeof(value));
+  return value;
+}
+
+bool Preferences::remove(const char *key) {
+  if (!opened || readOnly) return false;
+  writes++;
+  return nvs().erase(std::string(space.c_str()) + "/" + key) > 0;
+}
+
+static const Adafruit_SPITFT *selectedPanel = nullptr;
+
+void mockBusReset() {
+  mockBus = MockBus();
+}
+
+void mockSelect(const Adafruit_SPITFT *panel) {
+  if (panel != selectedPanel) {
+    mockBus.panelSwitches++;
+    selectedPanel = panel;
+  }
+}
+
+String MockResponse::header(const String &name) const {
+  for (const auto &h : headers) {
+    if (h.first == name) return h.second;
+  }
+  return String();
+}
+
+String WebServer::arg(const String &name) const {
+  for (const auto &a : currentArgs) {
+    if (a.first == name) return a.second;
+  }
+  return String();
+}
+
+bool WebServer::hasArg(const String &name) const {
+  for (const auto &a : currentArgs) {
+    if (a.first == name) return true;
+  }
+  return false;
+}
+
+String WebServer::header(const String &name) const {
+  for (const auto &h : currentHeaders) {
+    if (h.first == name) return h.second;
+  }
+  return String();
+}
+
+bool WebServer::hasHeader(const String &name) const {
+  for (const auto &h : currentHeaders) {
+    if (h.first == name) return true;
+  }
+  return false;
+}
+
+void WebServer::sendHeader(const String &name, const String &value, bool first) {
+  if (first)
+    pendingHeaders.insert(pendingHeaders.begin(), {name, value});
+  else
+    pendingHeaders.push_back({name, value});
+}
+
+void WebServer::respond(int code, const char *content_type, size_t length) {
+  response.code = code;
+  response.bodyBytes = length;
+  // Status line, Content-Type, Content-Length and Connection as the real server emits them
+  response.headerBytes = 17 + 16 + (content_type ? strlen(content_type) : 0) + 24 + 21;
+  for (const auto &h : pendingHeaders) response.headerBytes += h.first.length() + h.second.length() + 4;
+  response.headers = pendingHeaders;
+  pendingHeaders.clear();
+}
+
+void WebServer::send(int code, const char *content_type, const String &content) {
+  respond(code, content_type, content.length());
+  response.body = content;
+}
+
+void WebServer::setContentLength(const size_t contentLength) {
+  (void)contentLength;
+}
+
+void WebServer::sendContent(const char *content, size_t contentLength) {
+  // Chunk size line and CRLF around the data
+  response.bodyBytes += contentLength + 4 + (contentLength > 0xFF ? 3 : 2);
+  response.body += String(std::string(content, contentLength));
+}
+
+void WebServer::sendContent(const String &content) {
+  sendContent(content.c_str(), content.length());
+}
+
+void WebServer::send_P(int code, PGM_P content_type, PGM_P content) {
+  respond(code, content_type, strlen(content));
+}
+
+void WebServer::send_P(int code, PGM_P content_type, PGM_P content, size_t contentLength) {
+  (void)content;
+  respond(code, content_type, contentLength);
+}
+
+bool WebServer::matchBraces(const String &pattern, const String &uri) {
+  std::string p = pattern.c_str(), u = uri.c_str();
+  size_t i = 0, j = 0;
+
+  pathArgs.clear();
+  while (i < p.size() && j <= u.size()) {
+    if (p.compare(i, 2, "{}") == 0) {
+      size_t end = u.find('/', j);
+      if (end == std::string::npos) end = u.size();
+      pathArgs.push_back(String(u.substr(j, end - j)));
+      i += 2;
+      j = end;
+    } else if (j < u.size() && p[i] == u[j]) {
+      i++;
+      j++;
+    } else {
+      return false;
+    }
+  }
+  return i == p.size() && j == u.size();
+}
+
+const WebServer::Route *WebServer::findRoute(HTTPMethod method, const String &uri) {
+  for (const auto &route : routes) {
+    bool match = route.braces ? matchBraces(route.uri, uri) : route.uri == uri;
+    if (match && (route.method == HTTP_ANY || route.method == method)) {
+      return &route;
+    }
+  }
+  return nullptr;
+}
+
+void WebServer::begin(HTTPMethod method, const String &uri, const MockArgs &args, const MockArgs &headers) {
+  currentMethod = method;
+  currentUri = uri;
+  currentArgs = args;
+  currentHeaders = headers;
+  response = MockResponse();
+  response.code = 0;
+  currentClient = WiFiClient::mockAccept();
+  response.peer = currentClient.mockPeer();
+}
+
+MockResponse WebServer::mockRequest(HTTPMethod method, const String &uri, const MockArgs &args,
+                                    const MockArgs &headers) {
+  begin(method, uri, args, headers);
+
+  const Route *route = findRoute(method, uri);
+  if (route)
+    route->fn();
+  else if (notFound)
+    notFound();
+  else
+    respond(404, "text/plain", 0);
+  response.waitsForClose = response.code == 0 && currentClient.connected();
+  return response;
+}
+
+MockResponse WebServer::mockRawRequest(HTTPMethod method, const String &uri, const uint8_t *body, size_t length,
+                                       const MockArgs &args) {
+  begin(method, uri, args, MockArgs());
+
+  const Route *route = findRoute(method, uri);
+  if (!route) {
+    respond(404, "text/plain", 0);
+    return response;
+  }
+
+  if (route->ufn && method != HTTP_GET) {
+    streamRaw(route, body, length);
+    currentRaw.status = RAW_END;
+    route->ufn();
+  } else {
+    currentArgs.push_back({"plain", String(std::string((const char *)body, length))});
+  }
+
+  route->fn();
+  return response;
+}
+
+void WebServer::mockAbortedRequest(HTTPMethod method, const String &uri, const uint8_t *body, size_t length) {
+  begin(method, uri, MockArgs(), MockArgs());
+
+  const Route *route = findRoute(method, uri);
+  if (route && route->ufn) {
+    streamRaw(route, body, length);
+    currentRaw.status = RAW_ABORTED;
+    route->ufn();
+  }
+  currentClient.stop();
+}
+
+void WebServer::streamRaw(const Route *route, const uint8_t *body, size_t length) {
+  currentRaw.status = RAW_START;
+  currentRaw.totalSize = 0;
+  currentRaw.currentSize = 0;
+  route->ufn();
+
+  currentRaw.status = RAW_WRITE;
+  while (currentRaw.totalSize < length) {
+    size_t chunk = min(length - currentRaw.totalSize, (size_t)HTTP_RAW_BUFLEN);
+    memcpy(currentRaw.buf, body + currentRaw.totalSize, chunk);
+    currentRaw.currentSize = chunk;
+    currentRaw.totalSize += chunk;
+    route->ufn();
+  }
+}
@@ -0,0 +1,17 @@
+/**
+ * @file UriBraces.h
+ * @brief Host stand-in for UriBraces, "{}" matches one path segment
+ */
+
+#ifndef MOCK_URI_BRACES_H
+#define MOCK_URI_BRACES_H
+
+#include "../Uri.h"
+
+class UriBraces : public Uri {
+public:
+  using Uri::Uri;
+  bool hasBraces() const override { return true; }
+};
+
+#endif
@@ -0,0 +1,211 @@
+/**
+ * @file replay.cpp
+ * @brief Replay of recorded request traces with per-route latency and bus cost
+ *
+ * Every *.trace file of the trace directory is fed through the mock web
+ * server request by request. The client behaves like the index page in a
+ * browser: it revalidates cached pages with their ETag. After each request
+ * the render task is drained, so the bus counters cover the whole request.
+ */
+
+#include <Arduino.h>
+#include <Adafruit_ST7735.h>
+#include <WebServer.h>
+#include <dirent.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+#include "panel_array.h"
+
+extern WebServer server;
+uint32_t renderBacklog();
+extern std::atomic<bool> flushPending;
+
+struct RouteStats {
+  unsigned long requests = 0;
+  unsigned long hostMicros = 0;
+  unsigned long maxHostMicros = 0;
+  double busMicros = 0;
+  double maxBusMicros = 0;
+  unsigned long transactions = 0;
+  unsigned long bytes = 0;
+  unsigned long httpBytes = 0;
+  double budget = -1;  // max bus time of one request, < 0 when not set
+};
+
+/**
+ * @brief Decode application/x-www-form-urlencoded arguments
+ *
+ * @param text 
+ * @return MockArgs 
+ */
+static MockArgs parseForm(const std::string &text) {
+  MockArgs args;
+  std::string name, value, *field = &name;
+
+  for (size_t i = 0; i <= text.size(); i++) {
+    char c = i < text.size() ? text[i] : '&';
+    if (c == '&') {
+      if (!name.empty()) {
+        args.push_back({String(name.c_str()), String(value.c_str())});
+      }
+      name.clear();
+      value.clear();
+      field = &name;
+    } else if (c == '=' && field == &name) {
+      field = &value;
+    } else if (c == '+') {
+      *field += ' ';
+    } else if (c == '%' && i + 2 < text.size()) {
+      *field += (char)strtol(text.substr(i + 1, 2).c_str(), NULL, 16);
+      i += 2;
+    } else {
+      *field += c;
+    }
+  }
+  return args;
+}
+
+/**
+ * @brief Decode hex string
+ *
+ * @param text 
+ * @return std::vector<uint8_t> 
+ */
+static std::vector<uint8_t> parseHex(const std::string &text) {
+  std::vector<uint8_t> out;
+
+  for (size_t i = 0; i + 1 < text.size(); i += 2) {
+    out.push_back(strtol(text.substr(i, 2).c_str(), NULL, 16));
+  }
+  return out;
+}
+
+/**
+ * @brief Replay one trace file
+ *
+ * @param path 
+ * @param routes statistics per route, budgets are read into it
+ * @param etags cached pages of the client
+ * @return int number of replayed requests, -1 when the file cannot be read
+ */
+static int replayTrace(const std::string &path, std::map<std::string, RouteStats> &routes,
+                       std::map<std::string, String> &etags) {
+  FILE *file = fopen(path.c_str(), "r");
+  char line[4096];
+  int count = 0;
+
+  if (!file) {
+    return -1;
+  }
+
+  while (fgets(line, sizeof(line), file)) {
+    char method[8], uri[64], body[4096] = "";
+    int fields = sscanf(line, "%7s %63s %4095s", method, uri, body);
+    if (fields < 2 || method[0] == '#') {
+      continue;
+    }
+
+    if (strcmp(method, "budget") == 0) {
+      // Budgets are for one panel, a full repaint sends every panel
+      routes[uri].budget = atof(body) * PANEL_COUNT;
+      continue;
+    }
+
+    std::string content = body;
+    MockArgs headers;
+    if (etags.count(uri)) {
+      headers.push_back({"If-None-Match", etags[uri]});
+    }
+
+    mockBusReset();
+    unsigned long start = micros();
+    MockResponse res;
+    if (content.compare(0, 4, "hex:") == 0) {
+      std::vector<uint8_t> raw = parseHex(content.substr(4));
+      res = server.mockRawRequest(HTTP_POST, uri, raw.data(), raw.size());
+    } else {
+      MockArgs args = content.compare(0, 5, "form:") == 0 ? parseForm(content.substr(5)) : MockArgs();
+      res = server.mockRequest(strcmp(method, "GET") == 0 ? HTTP_GET : HTTP_POST, uri, args, headers);
+    }
+    // The flush is deferred to the render tick, wait for it as well so it
+    // is not counted against the next request
+    while (renderBacklog() > 0 || flushPending) {
+      yield();
+    }
+    unsigned long elapsed = micros() - start;
+
+    if (res.header("ETag").length() > 0) {
+      etags[uri] = res.header("ETag");
+    }
+
+    RouteStats &stats = routes[uri];
+    double busMicros = mockBus.busNanos / 1000.0;
+    stats.requests++;
+    stats.hostMicros += elapsed;
+    stats.maxHostMicros = std::max(stats.maxHostMicros, elapsed);
+    stats.busMicros += busMicros;
+    stats.maxBusMicros = std::max(stats.maxBusMicros, busMicros);
+    stats.transactions += mockBus.transactions;
+    stats.bytes += mockBus.bytes;
+    stats.httpBytes += res.headerBytes + res.bodyBytes;
+    count++;
+  }
+
+  fclose(file);
+  return count;
+}
+
+/**
+ * @brief Replay all traces of a directory and print a table per route
+ *
+ * @param dir 
+ * @return true when every route stays within its budget
+ */
+bool replayTraces(const char *dir) {
+  std::vector<std::string> files;
+  DIR *d = opendir(dir);
+  bool ok = true;
+
+  if (!d) {
+    printf("replay: no trace directory %s\n", dir);
+    return true;
+  }
+  for (struct dirent *e = readdir(d); e; e = readdir(d)) {
+    std::string name = e->d_name;
+    if (name.size() > 6 && name.compare(name.size() - 6, 6, ".trace") == 0) {
+      files.push_back(name);
+    }
+  }
+  closedir(d);
+  std::sort(files.begin(), files.end());
+
+  for (const std::string &name : files) {
+    std::map<std::string, RouteStats> routes;
+    std::map<std::string, String> etags;
+
+    if (replayTrace(std::string(dir) + "/" + name, routes, etags) < 0) {
+      printf("replay: cannot read %s\n", name.c_str());
+      ok = false;
+      continue;
+    }
+
+    printf("\n%-22s %5s %10s %10s %10s %10s %10s %10s %10s\n", name.c_str(), "reqs", "host-avg", "host-max",
+           "bus-avg", "bus-max", "spi-trans", "spi-bytes", "http-bytes");
+    for (const auto &entry : routes) {
+      const RouteStats &stats = entry.second;
+      if (stats.requests == 0) {
+        continue;
+      }
+      bool within = stats.budget < 0 || stats.maxBusMicros <= stats.budget;
+      printf("%-22s %5lu %7lu us %7lu us %7.0f us %7.0f us %10lu %10lu %10lu%s\n", entry.first.c_str(),
+             stats.requests, stats.hostMicros / stats.requests, stats.maxHostMicros,
+             stats.busMicros / stats.requests, stats.maxBusMicros, stats.transactions, stats.bytes,
+             stats.httpBytes, within ? "" : "  OVER BUDGET");
+      ok = ok && within;
+    }
+  }
+  return ok;
+}
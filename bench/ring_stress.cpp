@@ -0,0 +1,66 @@
+/**
+ * @file ring_stress.cpp
+ * @brief Stress run of CommandRing with a producer and a consumer thread
+ */
+
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+#include "command_ring.h"
+
+#define STRESS_ITEMS 20000000u
+
+struct StressItem {
+  uint32_t seq;
+  uint32_t check;
+  uint8_t payload[32];
+};
+
+static CommandRing<StressItem, 64> ring;
+
+/**
+ * @brief Push STRESS_ITEMS sequence numbered items through the ring and
+ *        verify on the consumer side that none is lost, duplicated,
+ *        reordered or torn. Prints throughput and how often each side
+ *        found the ring full/empty.
+ *
+ * @return true when every item arrived intact
+ */
+bool ringStress() {
+  unsigned long fullSpins = 0;
+  unsigned long emptySpins = 0;
+  unsigned long errors = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  std::thread consumer([&]() {
+    StressItem item;
+    for (uint32_t expected = 0; expected < STRESS_ITEMS;) {
+      if (!ring.pop(item)) {
+        emptySpins++;
+        std::this_thread::yield();
+        continue;
+      }
+      if (item.seq != expected || item.check != ~expected || item.payload[31] != (uint8_t)expected) {
+        errors++;
+      }
+      expected++;
+    }
+  });
+
+  StressItem item = {};
+  for (uint32_t seq = 0; seq < STRESS_ITEMS; seq++) {
+    item.seq = seq;
+    item.check = ~seq;
+    item.payload[31] = (uint8_t)seq;
+    while (!ring.push(item)) {
+      fullSpins++;
+      std::this_thread::yield();
+    }
+  }
+  consumer.join();
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("ring stress: %u items in %.2f s (%.1f M/s), full spins %lu, empty spins %lu, errors %lu\n",
+         STRESS_ITEMS, seconds, STRESS_ITEMS / seconds / 1e6, fullSpins, emptySpins, errors);
+  return errors == 0;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file animation.h
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Frame sequence of the grid stored as deltas between frames
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "grid.h"
+
+// Delta records, each one the smaller of a list of changed cells (3 B per
+// cell: x, y, cell code as live drawing) and a changed cell bitmask with a
+// nibble per changed cell (as History). The store holds a full-grid frame
+// as a bitmask with room for the changes of the frames after it.
+#define ANIMATION_BYTES      (GridLayout::CELLS < 8192 ? 16384 : 2 * GridLayout::CELLS)
+#define ANIMATION_DELTA_SIZE 3
+#define ANIMATION_MAX_FRAMES 256
+
+#define ANIMATION_CELL_LIST  0  // first byte of a record
+#define ANIMATION_CELL_MASK  1
+#define ANIMATION_CHANGED    0x80  // cell of the frame being received differs from the previous frame
+
+#define ANIMATION_DEFAULT_FPS 10
+#define ANIMATION_MAX_FPS     30
+
+static_assert(ANIMATION_BYTES <= 0xFFFF, "record offsets are 16 bit");
+
+/**
+ * @brief Position in a record while its changed cells are read
+ * 
+ */
+struct AnimationCursor {
+  uint16_t record;
+  uint16_t cell;   // next cell to test in a bitmask record
+  uint16_t index;  // changed cells read so far
+};
+
+/**
+ * @brief Frames arrive as whole grids of cell codes (0 = empty, n =
+ *        palette index n - 1, at most 15) and are diffed against the
+ *        previous frame while they stream in, so only the cells that
+ *        change are stored. Record n leads from frame n - 1 to frame n
+ *        (from the empty grid for frame 0); one more record, number
+ *        frameCount(), leads from the last frame back to the first for
+ *        looping.
+ * 
+ */
+class Animation {
+public:
+  Animation() { begin(0, NULL); }
+
+  void begin(uint8_t maxCode, uint8_t *frame);
+  bool feed(const uint8_t *data, size_t length);
+  bool end();
+
+  AnimationCursor read(uint16_t n) const;
+  bool next(AnimationCursor &cursor, uint16_t &cell, uint8_t &code) const;
+  uint16_t frameCount() const { return frames; }
+  size_t bytesUsed() const { return used; }
+  bool hasFailed() const { return failed; }
+  bool isFull() const { return full; }
+
+private:
+  void mark(uint16_t cell, uint8_t code);
+  bool store();
+
+  uint8_t *last;  // frame received last, a cell per byte; lent by the caller until end()
+  uint8_t data[ANIMATION_BYTES];
+  uint16_t start[ANIMATION_MAX_FRAMES + 2];  // record n is data[start[n]] .. data[start[n + 1] - 1]
+  uint16_t frames;
+  uint16_t used;
+  uint16_t changes;   // cells marked ANIMATION_CHANGED in last
+  uint32_t position;  // cell of the frame being received
+  uint8_t maxCode;
+  bool failed;
+  bool full;
+};
+
+#endif
@@ -0,0 +1,181 @@
+/**
+ * @file canvas.h
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Off-screen palette indexed framebuffer with dirty rectangle tracking
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <string.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_SPITFT.h>
+#include "lcd_dma.h"
+
+// Bits per pixel of the framebuffer: 8 (256 colours, 16 KB at 128x128)
+// or 4 (16 colours, 8 KB; images keep few of their colours)
+#ifndef CANVAS_BPP
+#define CANVAS_BPP 8
+#endif
+#define CANVAS_COLORS (1 << CANVAS_BPP)
+
+// Levels per channel of the colour cube that image colours fall back to
+// once the free entries are used up, none at 4bpp
+#define CANVAS_CUBE_LEVELS (CANVAS_BPP == 8 ? 5 : 0)
+#define CANVAS_CUBE_SIZE   (CANVAS_CUBE_LEVELS * CANVAS_CUBE_LEVELS * CANVAS_CUBE_LEVELS)
+
+// Maximum number of separate regions kept before they are merged
+#define CANVAS_MAX_DIRTY 8
+
+// Command and parameter bytes of one address window (CASET, RASET, RAMWR)
+#define CANVAS_WINDOW_BYTES 11
+
+// Rows expanded to RGB565 per writePixels call of the blocking flush
+#define CANVAS_LINE_ROWS 8
+
+/**
+ * @brief Fill kernel of one Cell x Cell grid cell at a cell aligned x, y.
+ *        For cells of two or more pixels every row is whole bytes of the
+ *        buffer; 1 pixel cells at 4bpp are specialized below.
+ * 
+ */
+template <int Cell, int Bpp>
+struct CellFill {
+  static void fill(uint8_t *buffer, int16_t width, int16_t x, int16_t y, uint8_t index) {
+    uint8_t pattern = Bpp == 4 ? index | index << 4 : index;
+    for (int j = 0; j < Cell; j++) {
+      memset(&buffer[((size_t)(y + j) * width + x) * Bpp / 8], pattern, Cell * Bpp / 8);
+    }
+  }
+};
+
+template <>
+struct CellFill<1, 4> {
+  static void fill(uint8_t *buffer, int16_t width, int16_t x, int16_t y, uint8_t index) {
+    size_t p = (size_t)y * width + x;
+    uint8_t &b = buffer[p >> 1];
+    b = (p & 1) ? (b & 0x0F) | index << 4 : (b & 0xF0) | index;
+  }
+};
+
+/**
+ * @brief Rectangle in canvas coordinates
+ * 
+ */
+struct DirtyRect {
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+};
+
+/**
+ * @brief Framebuffer that all drawing goes to. Pixels are palette indices,
+ *        RGB565 colours are looked up only when a region is flushed, so a
+ *        palette change recolours every pixel of that index. Changed
+ *        regions are remembered and sent to the display by flush(), each
+ *        region in one address window.
+ * 
+ *        Drawing colours get an index on first use. Entries below the
+ *        reserved count are fixed; the others are handed out again after
+ *        fillScreen(). When the palette is full, a colour maps to the
+ *        reserved colour cube if there is one, else to the nearest entry.
+ */
+class Canvas : public Adafruit_GFX {
+public:
+  Canvas(int16_t w, int16_t h);
+  ~Canvas();
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+  void fillScreen(uint16_t color) override;
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+  void writeSpan(int16_t x, int16_t y, const uint16_t *colors, int16_t w);
+  void drawMask(int16_t x, int16_t y, int16_t w, int16_t h, const uint8_t *mask, int16_t stride, uint16_t color);
+  void scrollRows(int16_t rows);
+
+  /**
+   * @brief Fill grid cell (col, row) of Cell x Cell pixels without clipping
+   * 
+   * @param col 
+   * @param row 
+   * @param color 
+   */
+  template <int Cell>
+  void fillCell(int16_t col, int16_t row, uint16_t color) {
+    fillCell<Cell>(col, row, colorIndex(color));
+  }
+
+  /**
+   * @brief Fill grid cell (col, row) with palette index, so the cell
+   *        follows later changes of that entry
+   * 
+   * @param col 
+   * @param row 
+   * @param index 
+   */
+  template <int Cell>
+  void fillCell(int16_t col, int16_t row, uint8_t index) {
+    if (buffer) {
+      CellFill<Cell, CANVAS_BPP>::fill(buffer, WIDTH, col * Cell, row * Cell, index);
+      markDirty(col * Cell, row * Cell, Cell, Cell);
+    }
+  }
+
+  uint16_t getPixel(int16_t x, int16_t y) const;
+  uint8_t getIndex(int16_t x, int16_t y) const;
+  uint16_t getPaletteColor(uint8_t index) const { return lut[index]; }
+  void setPaletteColor(uint8_t index, uint16_t color);
+  void reservePalette(uint16_t count);
+  void reserveColorCube();
+  uint8_t colorIndex(uint16_t color);
+  size_t bufferSize() const { return (size_t)WIDTH * HEIGHT * CANVAS_BPP / 8; }
+
+  bool isDirty() const { return dirtyCount > 0; }
+  void markDirty(int16_t x, int16_t y, int16_t w, int16_t h);
+  uint8_t regionCount() const { return dirtyCount; }
+  const DirtyRect &region(uint8_t i) const { return dirty[i]; }
+  void clearDirty() { dirtyCount = 0; }
+  void flush(Adafruit_SPITFT &display);
+  void flush(LcdDma &lcd);
+  void writeRegion(Adafruit_SPITFT &display, const DirtyRect &r, int16_t x, int16_t y);
+  void writeRegion(LcdDma &lcd, const DirtyRect &r, int16_t x, int16_t y);
+
+  uint32_t windowsFlushed() const { return windows; }
+  uint32_t bytesFlushed() const { return bytes; }
+
+private:
+  void fillIndex(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t index);
+  uint8_t cubeIndex(uint16_t color) const;
+  void expandRow(uint16_t *dst, const uint16_t *table, int16_t x, int16_t y, int16_t w) const;
+  void countWindow(const DirtyRect &r);
+  static void panelRow(uint16_t *dst, int16_t x, int16_t y, int16_t w, void *context);
+
+  // Row source context of writeRegion(): canvas and its offset to the panel
+  struct RegionSource {
+    const Canvas *canvas;
+    int16_t dx;
+    int16_t dy;
+  };
+
+  uint8_t *buffer;
+  uint16_t *line;                   // RGB565 rows for the blocking flush
+  uint16_t lut[CANVAS_COLORS];
+  uint16_t panelLut[CANVAS_COLORS]; // same colours, byte swapped as the panel expects
+  uint16_t used;                    // entries handed out, 0 .. used - 1
+  uint16_t reserved;                // entries kept by fillScreen()
+  uint16_t cubeStart;               // first colour cube entry, 0 when there is none
+  uint16_t lastColor;               // most recent colorIndex() lookup
+  uint8_t lastIndex;
+  bool lastValid;
+  DirtyRect dirty[CANVAS_MAX_DIRTY];
+  uint8_t dirtyCount;
+  uint32_t windows;
+  uint32_t bytes;
+};
+
+#endif
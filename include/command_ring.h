@@ -0,0 +1,83 @@
+/**
+ * @file command_ring.h
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Lock-free single-producer/single-consumer ring buffer
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef COMMAND_RING_H
+#define COMMAND_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief Fixed size queue between exactly one producer and one consumer
+ *        (e.g. tasks on different cores). Head is written only by the
+ *        producer, tail only by the consumer, so no lock is needed.
+ * 
+ * @tparam T item type, copied in and out
+ * @tparam N capacity, power of two
+ */
+template <typename T, size_t N>
+class CommandRing {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+  CommandRing() : head(0), tail(0) {}
+
+  /**
+   * @brief Append item, producer side
+   * 
+   * @param item 
+   * @return false when the ring is full
+   */
+  bool push(const T &item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == N) {
+      return false;
+    }
+
+    items[h & (N - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Take the oldest item, consumer side
+   * 
+   * @param item 
+   * @return false when the ring is empty
+   */
+  bool pop(T &item) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    item = items[t & (N - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Number of queued items, exact only from the producer or consumer
+   * 
+   * @return size_t 
+   */
+  size_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  static constexpr size_t capacity() { return N; }
+
+private:
+  T items[N];
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+};
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * @file grid.h
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Compile-time grid layout and the colours of the grid currently shown
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef GRID_H
+#define GRID_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Cells per side: 16, 32, 64 or 128 on the 128x128 panel. Set with
+// -DGRID_SIZE=n in build_flags, scripts/embed_web.py builds the page for it.
+#ifndef GRID_SIZE
+#define GRID_SIZE 16
+#endif
+
+#define GRID_PIXELS 128
+
+/**
+ * @brief Layout of a Size x Size grid of Cell x Cell pixel cells. Buffers,
+ *        request body sizes, loops and the cell fill kernel are all derived
+ *        from one instance, so nothing branches on the resolution at run time.
+ * 
+ */
+template <int Size, int Cell>
+struct GridConfig {
+  static_assert(Size * Cell == GRID_PIXELS, "cells have to cover the panel");
+  static_assert(Size % 8 == 0 && Size <= 256, "rows of the bitmask are whole bytes, coordinates are one byte");
+
+  enum : int {
+    SIZE = Size,
+    CELL = Cell,
+    CELLS = Size * Size,
+    MASK_BYTES = Size * Size / 8,
+  };
+};
+
+typedef GridConfig<GRID_SIZE, GRID_PIXELS / GRID_SIZE> GridLayout;
+
+static_assert(GRID_SIZE == 16 || GRID_SIZE == 32 || GRID_SIZE == 64 || GRID_SIZE == 128,
+              "supported grids: 16x16@8, 32x32@4, 64x64@2, 128x128@1");
+
+/**
+ * @brief Cell code of every grid cell as currently shown on the display
+ *        (0 = empty, n = palette index n - 1), one byte per cell. Used to
+ *        send only the cells that changed since the last commit; codes
+ *        stay right when a palette colour is changed.
+ * 
+ */
+template <class Layout>
+class BasicGrid {
+public:
+  BasicGrid() : valid(false) {}
+
+  /**
+   * @brief Display no longer shows the grid (e.g. text was printed)
+   * 
+   */
+  void invalidate() { valid = false; }
+
+  bool isValid() const { return valid; }
+
+  /**
+   * @brief Empty every cell after the screen was cleared
+   * 
+   */
+  void reset() {
+    memset(cells, 0, sizeof(cells));
+    valid = true;
+  }
+
+  uint8_t get(int x, int y) const { return cells[y * Layout::SIZE + x]; }
+  const uint8_t *codes() const { return cells; }
+
+  /**
+   * @brief Store code of a cell
+   * 
+   * @param x 
+   * @param y 
+   * @param code 
+   * @return true if the cell changed
+   */
+  bool set(int x, int y, uint8_t code) {
+    uint8_t &cell = cells[y * Layout::SIZE + x];
+
+    if (cell == code) {
+      return false;
+    }
+    cell = code;
+    return true;
+  }
+
+private:
+  uint8_t cells[Layout::CELLS];
+  bool valid;
+};
+
+typedef BasicGrid<GridLayout> Grid;
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file history.h
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Undo/redo history of the grid kept as deltas in a byte ring
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "grid.h"
+
+#define HISTORY_CELLS       GridLayout::CELLS
+#define HISTORY_MASK_BYTES  GridLayout::MASK_BYTES
+
+// Ring of delta records; the oldest records are dropped when it is full.
+// Grows with finer grids so a few masks still fit.
+#define HISTORY_BYTES       (HISTORY_CELLS < 2048 ? 2048 : HISTORY_CELLS)
+#define HISTORY_MAX_RECORDS 64
+
+// Largest output of save(): header, current cells, record lengths, ring
+#define HISTORY_SAVE_SIZE   (16 + HISTORY_CELLS + HISTORY_MAX_RECORDS * 2 + HISTORY_BYTES)
+
+/**
+ * @brief Versions of the grid as cell codes (0 = empty, n = palette
+ *        index n - 1, at most 15). Only the current version is kept
+ *        whole; every step between versions is one record of a changed
+ *        cell bitmask followed by one byte (old << 4 | new) per changed
+ *        cell, so a step can be replayed in both directions.
+ * 
+ */
+class History {
+public:
+  History() { reset(NULL); }
+
+  void reset(const uint8_t *codes);
+  bool record(const uint8_t *codes);
+  bool undo();
+  bool redo();
+  bool seek(uint32_t target);
+
+  const uint8_t *codes() const { return state; }
+  uint32_t version() const { return current; }
+  uint32_t oldest() const { return first; }
+  uint32_t newest() const { return last; }
+  uint32_t changes() const { return changeCount; }
+  size_t bytesUsed() const { return used; }
+
+  size_t save(uint8_t *out) const;
+  bool load(const uint8_t *in, size_t size);
+
+private:
+  void apply(uint32_t version, bool forward);
+  void dropOldest();
+  uint8_t at(size_t offset) const { return ring[offset % HISTORY_BYTES]; }
+
+  uint8_t state[HISTORY_CELLS];
+  uint8_t ring[HISTORY_BYTES];
+  uint16_t start[HISTORY_MAX_RECORDS];  // record of version v is at slot v % HISTORY_MAX_RECORDS
+  uint16_t length[HISTORY_MAX_RECORDS];
+  uint32_t first;    // oldest reachable version, records first + 1 .. last exist
+  uint32_t current;
+  uint32_t last;
+  uint16_t tail;     // ring offset of the oldest record
+  uint16_t head;     // ring offset after the newest record
+  uint16_t used;
+  uint32_t changeCount;
+};
+
+#endif
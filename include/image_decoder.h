@@ -0,0 +1,70 @@
+/**
+ * @file image_decoder.h
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Incremental decoder of uploaded images (raw RGB565, RLE, QOI)
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum ImageFormat : uint8_t {
+  IMAGE_RGB565, // 2 B per pixel, little endian
+  IMAGE_RLE,    // 3 B per run: count - 1, colour low, colour high
+  IMAGE_QOI,    // https://qoiformat.org, size taken from the header
+};
+
+/**
+ * @brief Receives decoded pixels in row order
+ * 
+ */
+typedef void (*PixelSink)(uint16_t x, uint16_t y, uint16_t color, void *ctx);
+
+/**
+ * @brief Decodes an image fed in arbitrary chunks. Keeps no more than one
+ *        pending op of input; every pixel goes straight to the sink.
+ * 
+ */
+class ImageDecoder {
+public:
+  ImageDecoder() : sink(NULL), ctx(NULL), failed(true) {}
+
+  void begin(ImageFormat format, uint16_t width, uint16_t height, PixelSink sink, void *ctx);
+  bool feed(const uint8_t *data, size_t length);
+
+  bool isComplete() const { return !failed && total > 0 && emitted == total; }
+  bool hasFailed() const { return failed; }
+  uint16_t width() const { return w; }
+  uint16_t height() const { return h; }
+  uint32_t pixels() const { return emitted; }
+
+private:
+  void emit(uint16_t color, uint32_t count);
+  bool feedQoi(uint8_t byte);
+
+  ImageFormat format;
+  PixelSink sink;
+  void *ctx;
+  bool failed;
+  uint16_t w, h;
+  uint16_t maxWidth, maxHeight;
+  uint32_t total;
+  uint32_t emitted;
+  uint16_t x, y;
+
+  // Bytes of the op (or header) being assembled
+  uint8_t pending[14];
+  uint8_t pendingLength;
+  uint8_t pendingNeed;
+
+  // QOI state
+  uint8_t px[4];
+  uint8_t index[64][4];
+};
+
+#endif
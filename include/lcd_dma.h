@@ -0,0 +1,64 @@
+/**
+ * @file lcd_dma.h
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief DMA driven pixel output to the ST7735 over the ESP-IDF SPI master
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef LCD_DMA_H
+#define LCD_DMA_H
+
+#include <Arduino.h>
+#include <driver/spi_master.h>
+
+// Canvas rows converted into one DMA buffer
+#define LCD_DMA_LINES 8
+
+/**
+ * @brief Fills w pixels of row y starting at x, RGB565 in panel byte order
+ *        (big endian)
+ * 
+ */
+typedef void (*LcdRowSource)(uint16_t *dst, int16_t x, int16_t y, int16_t w, void *context);
+
+/**
+ * @brief Streams rectangles of a framebuffer to the panel. Two line
+ *        buffers are used in turns: while DMA transmits one, the CPU fills
+ *        the next rows into the other through a row source.
+ * 
+ *        The panel has to be initialized (e.g. by Adafruit_ST7735::initR)
+ *        before begin() takes the SPI bus over from the Arduino driver.
+ * 
+ *        Constructed with cs -1, the chip select is left to the caller:
+ *        select() drives the CS pins of several panels on the same bus,
+ *        which keeps one SPI device and one pair of line buffers for all.
+ */
+class LcdDma {
+public:
+  LcdDma(int8_t sclk, int8_t mosi, int8_t cs, int8_t dc, int16_t xOffset, int16_t yOffset);
+
+  bool begin(uint32_t freq, int16_t width);
+  bool isReady() const { return spi != NULL; }
+  void select(int8_t panelCs);
+  void sendCommand(uint8_t cmd, const uint8_t *data, uint8_t length);
+  void writeRect(LcdRowSource source, void *context, int16_t x, int16_t y, int16_t w, int16_t h);
+  void finish();
+
+private:
+  void command(uint8_t cmd, const uint8_t *data, uint8_t length);
+  void waitBuffer(uint8_t i);
+
+  int8_t sclk, mosi, cs, dc;
+  int8_t selected;  // CS pin driven low by select(), -1 for none
+  int16_t xOffset, yOffset;
+  int16_t width;
+  spi_device_handle_t spi;
+  uint16_t *lines[2];
+  spi_transaction_t trans[2];
+  bool inFlight[2];
+  uint8_t next;
+};
+
+#endif
@@ -0,0 +1,77 @@
+/**
+ * @file metrics.h
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Request timing histograms exported in Prometheus text format
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+
+#define METRICS_MAX_ROUTES 16
+
+// Upper bounds of the histogram buckets in microseconds, +Inf is implicit
+#define METRICS_BUCKETS 10
+#define METRICS_BUCKET_BOUNDS {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000, 500000}
+
+enum MetricsPhase : uint8_t {
+  PHASE_PARSE,  // request arguments and body
+  PHASE_RENDER, // diffing and queueing draw commands
+  PHASE_SEND,   // response written to the client
+  PHASE_COUNT,
+};
+
+/**
+ * @brief Latency histogram with fixed buckets, times in CPU cycles
+ * 
+ */
+struct Histogram {
+  uint32_t buckets[METRICS_BUCKETS + 1];
+  uint32_t count;
+  uint64_t sumCycles;
+
+  void add(uint32_t cycles);
+};
+
+/**
+ * @brief Per route request counts and phase timings measured with the CPU
+ *        cycle counter. All storage is static, recording a request does
+ *        not allocate.
+ * 
+ */
+class Metrics {
+public:
+  Metrics() : routeCount(0), active(false) {}
+
+  int addRoute(const char *uri);
+  void begin(int route);
+  void phase(MetricsPhase next);
+  void end();
+
+  void print(Print &out) const;
+
+  static void printHistogram(Print &out, const char *name, const char *labels, const Histogram &histogram);
+  static void printValue(Print &out, const char *name, const char *type, const char *help, double value);
+
+private:
+  struct Route {
+    const char *uri;
+    uint32_t requests;
+    Histogram phases[PHASE_COUNT];
+  };
+
+  Route routes[METRICS_MAX_ROUTES];
+  uint8_t routeCount;
+
+  // Request in progress
+  bool active;
+  uint8_t route;
+  MetricsPhase current;
+  uint32_t phaseStart;
+};
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ * @file panel_array.h
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Canvas tiled across several panels that share one SPI bus
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef PANEL_ARRAY_H
+#define PANEL_ARRAY_H
+
+#include <Adafruit_SPITFT.h>
+#include "canvas.h"
+#include "lcd_dma.h"
+
+// Panels of the display, side by side and stacked. Set with
+// -DPANEL_COLS=n -DPANEL_ROWS=n in build_flags.
+#ifndef PANEL_COLS
+#define PANEL_COLS 1
+#endif
+#ifndef PANEL_ROWS
+#define PANEL_ROWS 1
+#endif
+#define PANEL_COUNT (PANEL_COLS * PANEL_ROWS)
+
+// Most panels one array drives
+#define PANEL_MAX 16
+
+/**
+ * @brief Panels on one SPI bus, each with its own chip select, showing
+ *        tiles of one canvas: panel (col, row) shows the canvas area at
+ *        (col * width, row * height). Drawing goes to the canvas as a
+ *        whole; flush() splits its dirty regions at the tile edges.
+ * 
+ *        All regions of one panel are sent under one chip select, and a
+ *        flush starts with the panel addressed last, so the chip select
+ *        changes at most once per panel that has something to show.
+ */
+class PanelArray {
+public:
+  PanelArray(uint8_t cols, uint8_t rows, int16_t width, int16_t height);
+
+  void setPanel(uint8_t col, uint8_t row, Adafruit_SPITFT *display, int8_t cs);
+  void setDma(LcdDma *lcd) { this->lcd = lcd; }
+  void flush(Canvas &canvas);
+  void sendCommand(uint8_t cmd, const uint8_t *data, uint8_t length);
+
+  uint8_t count() const { return cols * rows; }
+  Adafruit_SPITFT *display(uint8_t i) const { return panels[i].display; }
+  uint32_t panelSwitches() const { return switches; }
+
+private:
+  struct Panel {
+    Adafruit_SPITFT *display;
+    int8_t cs;
+  };
+
+  bool useDma() const { return lcd && lcd->isReady(); }
+  void select(uint8_t i);
+
+  uint8_t cols;
+  uint8_t rows;
+  int16_t width;
+  int16_t height;
+  Panel panels[PANEL_MAX];
+  LcdDma *lcd;       // NULL or not ready: blocking writes through the displays
+  int8_t current;    // panel addressed last, -1 before the first one
+  uint32_t switches;
+};
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * @file screen_mirror.h
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Canvas contents for browsers: RLE snapshots and a server-sent
+ *        events stream of changed regions
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef SCREEN_MIRROR_H
+#define SCREEN_MIRROR_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include "canvas.h"
+#include "command_ring.h"
+
+// Open event streams; more viewers are turned away
+#define SCREEN_MAX_VIEWERS 4
+
+// Flushed regions waiting for loop(), a full screen is sent on overflow
+#define SCREEN_PENDING_RECTS 32
+
+// Regions listed in one event, more are sent as their bounding box
+#define SCREEN_EVENT_RECTS 8
+
+// Comment line sent to idle streams, finds viewers that went away
+#define SCREEN_KEEPALIVE_MS 15000
+
+/**
+ * @brief Mirror of what the panels show, taken from the canvas without
+ *        reading back over SPI. The render task reports every region it
+ *        flushes; loop() turns them into "dirty" events for all open
+ *        streams, and viewers fetch those regions as RLE (same runs as
+ *        /image format=rle: count - 1, colour low, colour high).
+ * 
+ *        Snapshots are read while the render task may draw, so one can mix
+ *        two updates; the event of the later update makes viewers fetch
+ *        the region again.
+ * 
+ */
+class ScreenMirror {
+public:
+  ScreenMirror(Canvas &canvas);
+
+  // Render task side
+  void notify(const DirtyRect &r);
+  void notifyCanvas();
+  void setScroll(int16_t offset);
+
+  // loop() side
+  bool addViewer(WiFiClient &client);
+  void poll();
+  size_t writeRle(Print &out, int16_t x, int16_t y, int16_t w, int16_t h) const;
+
+  uint8_t viewerCount();
+  uint32_t eventsSent() const { return events; }
+
+private:
+  void sendEvent(const char *event, const char *data);
+
+  Canvas &canvas;
+  CommandRing<DirtyRect, SCREEN_PENDING_RECTS> updates;
+  std::atomic<bool> overflow;
+  std::atomic<int16_t> scroll;  // canvas row shown at the top, see TextRenderer
+  WiFiClient viewers[SCREEN_MAX_VIEWERS];
+  uint32_t events;
+  unsigned long lastEventAt;
+};
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * @file text_renderer.h
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Word wrapping text output with a glyph cache and hardware scrolling
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef TEXT_RENDERER_H
+#define TEXT_RENDERER_H
+
+#include <Arduino.h>
+#include "canvas.h"
+
+// Classic 5x7 font cell including the spacing column and row
+#define TEXT_GLYPH_W 6
+#define TEXT_GLYPH_H 8
+
+// Rasterized glyphs kept; sizes above TEXT_CACHED_SIZE are drawn uncached
+#define TEXT_CACHE_GLYPHS 64
+#define TEXT_CACHED_SIZE  2
+#define TEXT_MASK_STRIDE  ((TEXT_GLYPH_W * TEXT_CACHED_SIZE + 7) / 8)
+#define TEXT_MASK_BYTES   (TEXT_MASK_STRIDE * TEXT_GLYPH_H * TEXT_CACHED_SIZE)
+
+// Longest word kept together, longer ones are split
+#define TEXT_MAX_WORD 32
+
+/**
+ * @brief Called for every row of a scroll with the canvas row now shown at
+ *        the top of the panel. It has to flush the canvas and move the
+ *        panel's scroll start there.
+ * 
+ */
+typedef void (*TextScrollStep)(int16_t offset);
+
+/**
+ * @brief Text output to the canvas. Glyphs are rasterized once per size into
+ *        a 1bpp mask and blitted in one piece; the colour comes from the
+ *        canvas palette. Words are wrapped as a whole. Lines below the
+ *        screen are dropped, or in scroll mode the panel scrolls up pixel
+ *        by pixel with its vertical scroll start, so the canvas rows are
+ *        used as a ring and only the new line is drawn.
+ * 
+ */
+class TextRenderer {
+public:
+  TextRenderer(Canvas &canvas, TextScrollStep scrollStep);
+
+  void home();
+  void moveTo(int16_t x, int16_t y);
+  void setStyle(uint8_t size, uint16_t color);
+  void setScroll(bool enabled);
+  void write(const uint8_t *text, size_t length);
+  void newline();
+  void endWord();
+  void resetScroll(bool keepImage);
+
+  int16_t scrollOffset() const { return offset; }
+  bool isTruncated() const { return truncated; }
+  uint32_t cacheHits() const { return hits; }
+  uint32_t cacheMisses() const { return misses; }
+
+private:
+  struct Glyph {
+    uint8_t c;
+    uint8_t size;   // 0 for an empty slot
+    uint32_t used;
+    uint8_t mask[TEXT_MASK_BYTES];
+  };
+
+  const Glyph &glyph(uint8_t c);
+  void drawGlyph(uint8_t c);
+  bool fitLine();
+
+  Canvas &canvas;
+  TextScrollStep scrollStep;
+  int16_t left;     // margin lines start at
+  int16_t x;
+  int16_t y;        // screen row, the canvas row is (y + offset) % height
+  int16_t offset;   // canvas row shown at the top of the panel
+  uint8_t size;
+  uint16_t color;
+  bool scroll;
+  bool truncated;
+  uint8_t word[TEXT_MAX_WORD];
+  uint8_t wordLength;
+  Glyph cache[TEXT_CACHE_GLYPHS];
+  uint32_t useClock;
+  uint32_t hits;
+  uint32_t misses;
+};
+
+#endif
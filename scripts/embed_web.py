@@ -0,0 +1,90 @@
+"""
+Compress web/index.html into include/index_html.h.
+
+The page is built for the grid resolution of the firmware: {{GRID_SIZE}},
+{{CELL_PX}} and {{CELL_INNER_PX}} in the HTML are replaced, GRID_SIZE comes
+from -DGRID_SIZE=n in build_flags (default 16, same as include/grid.h).
+
+Runs as a PlatformIO pre-build script (see extra_scripts in platformio.ini)
+or standalone: python3 scripts/embed_web.py [grid size]
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+DEFAULT_GRID_SIZE = 16
+PAGE_GRID_PX = 480  # page width of the grid, cells are at least 4 px
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    PROJECT_DIR = env.subst("$PROJECT_DIR")  # noqa: F821
+    BUILD_FLAGS = " ".join(env.Flatten(env.get("BUILD_FLAGS", [])))  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    BUILD_FLAGS = "-DGRID_SIZE=%s" % sys.argv[1] if len(sys.argv) > 1 else ""
+
+SOURCE = os.path.join(PROJECT_DIR, "web", "index.html")
+TARGET = os.path.join(PROJECT_DIR, "include", "index_html.h")
+
+
+def minify(html):
+    """Drop indentation and blank lines, the page has no <pre> blocks."""
+    lines = (line.strip() for line in html.splitlines())
+    return "\n".join(line for line in lines if line)
+
+
+def grid_size():
+    match = re.search(r"-DGRID_SIZE=(\d+)", BUILD_FLAGS)
+    return int(match.group(1)) if match else DEFAULT_GRID_SIZE
+
+
+def fill_in(html, size):
+    cell = max(4, PAGE_GRID_PX // size)
+    values = {"GRID_SIZE": size, "CELL_PX": cell, "CELL_INNER_PX": cell - 2}
+    return re.sub(r"\{\{(\w+)\}\}", lambda m: str(values[m.group(1)]), html)
+
+
+def main():
+    size = grid_size()
+    with open(SOURCE, encoding="utf-8") as f:
+        html = minify(fill_in(f.read(), size)).encode("utf-8")
+
+    # mtime=0 keeps the output (and so the ETag) stable between builds
+    data = gzip.compress(html, compresslevel=9, mtime=0)
+    etag = hashlib.sha1(data).hexdigest()[:16]
+
+    rows = []
+    for i in range(0, len(data), 16):
+        rows.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+
+    header = "\n".join([
+        "// Generated by scripts/embed_web.py from web/index.html, do not edit",
+        "",
+        "#ifndef INDEX_HTML_H",
+        "#define INDEX_HTML_H",
+        "",
+        "#define INDEX_HTML_ETAG \"\\\"%s\\\"\"" % etag,
+        "#define INDEX_HTML_SIZE %d // uncompressed" % len(html),
+        "#define INDEX_HTML_GRID_SIZE %d" % size,
+        "",
+        "const uint8_t INDEX_HTML_GZ[] PROGMEM = {",
+        *rows,
+        "};",
+        "",
+        "#endif",
+        "",
+    ])
+
+    old = None
+    if os.path.exists(TARGET):
+        with open(TARGET, encoding="utf-8") as f:
+            old = f.read()
+    if old != header:
+        with open(TARGET, "w", encoding="utf-8") as f:
+            f.write(header)
+
+
+main()
@@ -0,0 +1,207 @@
+/**
+ * @file animation.cpp
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Frame sequence of the grid stored as deltas between frames
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#include <string.h>
+#include "animation.h"
+
+/**
+ * @brief Forget the frames, start receiving a new sequence
+ * 
+ * @param maxCode highest valid cell code
+ * @param frame CELLS bytes for the frame received last, used until end()
+ */
+void Animation::begin(uint8_t maxCode, uint8_t *frame) {
+  last = frame;
+  if (last) {
+    memset(last, 0, GridLayout::CELLS);
+  }
+  frames = 0;
+  used = 0;
+  changes = 0;
+  start[0] = 0;
+  position = 0;
+  this->maxCode = maxCode;
+  failed = false;
+  full = false;
+}
+
+/**
+ * @brief Set a cell of the frame being received, marking it when it changes
+ * 
+ * @param cell 
+ * @param code 
+ */
+void Animation::mark(uint16_t cell, uint8_t code) {
+  if (last[cell] != code) {
+    last[cell] = code | ANIMATION_CHANGED;
+    changes++;
+  }
+}
+
+/**
+ * @brief Append the record of the marked cells in the smaller encoding and
+ *        clear the marks
+ * 
+ * @return false when the store is full
+ */
+bool Animation::store() {
+  size_t listSize = 1 + (size_t)changes * ANIMATION_DELTA_SIZE;
+  size_t maskSize = 1 + GridLayout::MASK_BYTES + (changes + 1) / 2;
+  bool asMask = maskSize < listSize;
+  size_t size = asMask ? maskSize : listSize;
+
+  if (used + size > ANIMATION_BYTES) {
+    failed = full = true;
+    return false;
+  }
+
+  uint8_t *record = &data[used];
+  uint8_t *mask = record + 1;
+  uint8_t *codes = mask + GridLayout::MASK_BYTES;
+  uint8_t *out = record + 1;
+  uint16_t index = 0;
+
+  record[0] = asMask ? ANIMATION_CELL_MASK : ANIMATION_CELL_LIST;
+  if (asMask) {
+    memset(mask, 0, size - 1);
+  }
+  for (uint16_t cell = 0; index < changes; cell++) {
+    if (!(last[cell] & ANIMATION_CHANGED)) {
+      continue;
+    }
+    uint8_t code = last[cell] &= ~ANIMATION_CHANGED;
+    if (asMask) {
+      mask[cell >> 3] |= 1 << (cell & 7);
+      codes[index >> 1] |= index & 1 ? code : code << 4;
+    } else {
+      *out++ = cell % GridLayout::SIZE;
+      *out++ = cell / GridLayout::SIZE;
+      *out++ = code;
+    }
+    index++;
+  }
+  used += size;
+  changes = 0;
+  return true;
+}
+
+/**
+ * @brief Take the next bytes of the frames, in any chunks
+ * 
+ * @param data 
+ * @param length 
+ * @return false when the data is invalid or does not fit (isFull())
+ */
+bool Animation::feed(const uint8_t *data, size_t length) {
+  for (size_t i = 0; i < length && !failed; i++) {
+    uint8_t code = data[i];
+
+    if (frames == ANIMATION_MAX_FRAMES) {
+      failed = full = true;
+      break;
+    }
+    if (code > maxCode) {
+      failed = true;
+      break;
+    }
+    mark(position, code);
+    if (++position == GridLayout::CELLS) {
+      position = 0;
+      if (!store()) {
+        break;
+      }
+      start[++frames] = used;
+    }
+  }
+  return !failed;
+}
+
+/**
+ * @brief Finish the sequence and add the record back to the first frame
+ * 
+ * @return false when no frame or only part of one was received
+ */
+bool Animation::end() {
+  if (failed || frames == 0 || position != 0) {
+    failed = true;
+    return false;
+  }
+
+  // Frame 0 is record 0 applied to the empty grid
+  AnimationCursor cursor = read(0);
+  uint16_t cell = 0;
+  uint16_t changed;
+  uint8_t code;
+  while (next(cursor, changed, code)) {
+    for (; cell < changed; cell++) {
+      mark(cell, 0);
+    }
+    mark(cell++, code);
+  }
+  for (; cell < GridLayout::CELLS; cell++) {
+    mark(cell, 0);
+  }
+
+  if (!store()) {
+    return false;
+  }
+  start[frames + 1] = used;
+  last = NULL;
+  return true;
+}
+
+/**
+ * @brief Start reading the changed cells of record n
+ * 
+ * @param n 0 .. frameCount()
+ * @return AnimationCursor for next()
+ */
+AnimationCursor Animation::read(uint16_t n) const {
+  AnimationCursor cursor = {n, 0, 0};
+  return cursor;
+}
+
+/**
+ * @brief Next changed cell of a record, in cell order
+ * 
+ * @param cursor from read()
+ * @param cell y * GridLayout::SIZE + x
+ * @param code 
+ * @return false after the last changed cell
+ */
+bool Animation::next(AnimationCursor &cursor, uint16_t &cell, uint8_t &code) const {
+  const uint8_t *record = &data[start[cursor.record]];
+  size_t length = start[cursor.record + 1] - start[cursor.record];
+
+  if (record[0] == ANIMATION_CELL_LIST) {
+    size_t at = 1 + (size_t)cursor.index * ANIMATION_DELTA_SIZE;
+    if (at + ANIMATION_DELTA_SIZE > length) {
+      return false;
+    }
+    cell = record[at + 1] * GridLayout::SIZE + record[at];
+    code = record[at + 2];
+    cursor.index++;
+    return true;
+  }
+
+  const uint8_t *mask = record + 1;
+  while (cursor.cell < GridLayout::CELLS && !(mask[cursor.cell >> 3] & (1 << (cursor.cell & 7)))) {
+    // Whole bytes without changes are skipped at once
+    cursor.cell += (cursor.cell & 7) == 0 && mask[cursor.cell >> 3] == 0 ? 8 : 1;
+  }
+  if (cursor.cell == GridLayout::CELLS) {
+    return false;
+  }
+
+  uint8_t codes = mask[GridLayout::MASK_BYTES + (cursor.index >> 1)];
+  code = cursor.index & 1 ? codes & 0x0F : codes >> 4;
+  cell = cursor.cell++;
+  cursor.index++;
+  return true;
+}
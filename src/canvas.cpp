@@ -0,0 +1,574 @@
+/**
+ * @file canvas.cpp
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Off-screen palette indexed framebuffer with dirty rectangle tracking
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "canvas.h"
+
+/**
+ * @brief Area of the bounding box of two rectangles
+ * 
+ * @param a 
+ * @param b 
+ * @return int32_t 
+ */
+static int32_t unionArea(const DirtyRect &a, const DirtyRect &b) {
+  int16_t x1 = min(a.x, b.x);
+  int16_t y1 = min(a.y, b.y);
+  int16_t x2 = max(a.x + a.w, b.x + b.w);
+  int16_t y2 = max(a.y + a.h, b.y + b.h);
+  return (int32_t)(x2 - x1) * (y2 - y1);
+}
+
+/**
+ * @brief Grow rectangle a to the bounding box of a and b
+ * 
+ * @param a 
+ * @param b 
+ */
+static void unite(DirtyRect &a, const DirtyRect &b) {
+  int16_t x2 = max(a.x + a.w, b.x + b.w);
+  int16_t y2 = max(a.y + a.h, b.y + b.h);
+  a.x = min(a.x, b.x);
+  a.y = min(a.y, b.y);
+  a.w = x2 - a.x;
+  a.h = y2 - a.y;
+}
+
+/**
+ * @brief Check if two rectangles overlap or share an edge
+ * 
+ * @param a 
+ * @param b 
+ * @return true 
+ * @return false 
+ */
+static bool touches(const DirtyRect &a, const DirtyRect &b) {
+  return a.x <= b.x + b.w && b.x <= a.x + a.w &&
+         a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
+
+/**
+ * @brief Palette index of pixel p (y * width + x)
+ * 
+ * @param buffer 
+ * @param p 
+ * @return uint8_t 
+ */
+static inline uint8_t indexAt(const uint8_t *buffer, size_t p) {
+#if CANVAS_BPP == 4
+  return (p & 1) ? buffer[p >> 1] >> 4 : buffer[p >> 1] & 0x0F;
+#else
+  return buffer[p];
+#endif
+}
+
+/**
+ * @brief Set palette index of pixel p (y * width + x)
+ * 
+ * @param buffer 
+ * @param p 
+ * @param index 
+ */
+static inline void setIndexAt(uint8_t *buffer, size_t p, uint8_t index) {
+#if CANVAS_BPP == 4
+  uint8_t &b = buffer[p >> 1];
+  b = (p & 1) ? (b & 0x0F) | index << 4 : (b & 0xF0) | index;
+#else
+  buffer[p] = index;
+#endif
+}
+
+/**
+ * @brief Squared distance of two RGB565 colours, channels scaled to 6 bits
+ * 
+ * @param a 
+ * @param b 
+ * @return uint32_t 
+ */
+static uint32_t colorDistance(uint16_t a, uint16_t b) {
+  int32_t r = ((a >> 11) - (b >> 11)) * 2;
+  int32_t g = ((a >> 5) & 0x3F) - ((b >> 5) & 0x3F);
+  int32_t bl = ((a & 0x1F) - (b & 0x1F)) * 2;
+  return r * r + g * g + bl * bl;
+}
+
+Canvas::Canvas(int16_t w, int16_t h)
+    : Adafruit_GFX(w, h), used(1), reserved(0), cubeStart(0), lastValid(false), dirtyCount(0), windows(0), bytes(0) {
+  buffer = (uint8_t *)calloc(bufferSize(), 1);
+  line = (uint16_t *)malloc((size_t)w * CANVAS_LINE_ROWS * sizeof(uint16_t));
+  memset(lut, 0, sizeof(lut));
+  memset(panelLut, 0, sizeof(panelLut));
+}
+
+Canvas::~Canvas() {
+  free(buffer);
+  free(line);
+}
+
+/**
+ * @brief Remember a changed region, merging it with the regions it touches.
+ *        When the list is full, the region is merged with the one whose
+ *        bounding box grows the least.
+ * 
+ * @param x 
+ * @param y 
+ * @param w 
+ * @param h 
+ */
+void Canvas::markDirty(int16_t x, int16_t y, int16_t w, int16_t h) {
+  DirtyRect rect = {x, y, w, h};
+
+  for (uint8_t i = 0; i < dirtyCount; i++) {
+    if (touches(dirty[i], rect)) {
+      unite(rect, dirty[i]);
+      dirty[i] = dirty[--dirtyCount];
+      i = -1; // grown rectangle may now touch the earlier ones
+    }
+  }
+
+  if (dirtyCount == CANVAS_MAX_DIRTY) {
+    uint8_t best = 0;
+    int32_t bestGrowth = INT32_MAX;
+    for (uint8_t i = 0; i < dirtyCount; i++) {
+      int32_t growth = unionArea(dirty[i], rect) - (int32_t)dirty[i].w * dirty[i].h;
+      if (growth < bestGrowth) {
+        bestGrowth = growth;
+        best = i;
+      }
+    }
+    unite(rect, dirty[best]);
+    dirty[best] = dirty[--dirtyCount];
+  }
+
+  dirty[dirtyCount++] = rect;
+}
+
+/**
+ * @brief Level of a colour channel in the colour cube
+ * 
+ * @param value channel value
+ * @param max largest channel value (31 or 63)
+ * @return uint8_t 
+ */
+static uint8_t cubeLevel(uint8_t value, uint8_t max) {
+  return (value * (CANVAS_CUBE_LEVELS - 1) * 2 + max) / (max * 2);
+}
+
+/**
+ * @brief Colour cube entry closest to a colour, no search needed
+ * 
+ * @param color RGB565
+ * @return uint8_t 
+ */
+uint8_t Canvas::cubeIndex(uint16_t color) const {
+  uint8_t r = cubeLevel(color >> 11, 31);
+  uint8_t g = cubeLevel((color >> 5) & 0x3F, 63);
+  uint8_t b = cubeLevel(color & 0x1F, 31);
+
+  return cubeStart + (r * CANVAS_CUBE_LEVELS + g) * CANVAS_CUBE_LEVELS + b;
+}
+
+/**
+ * @brief Palette index for a drawing colour: the same entry, a free entry
+ *        or, when the palette is full, the colour cube or nearest entry
+ * 
+ * @param color RGB565
+ * @return uint8_t 
+ */
+uint8_t Canvas::colorIndex(uint16_t color) {
+  if (lastValid && color == lastColor) {
+    return lastIndex;
+  }
+
+  uint8_t index = 0;
+  uint16_t i;
+  for (i = 0; i < used && lut[i] != color; i++) {
+  }
+  if (i < used) {
+    index = i;
+  } else if (used < CANVAS_COLORS) {
+    // A free entry is not shown anywhere yet, no need to mark regions
+    index = used++;
+    lut[index] = color;
+    panelLut[index] = (color >> 8) | (color << 8);
+  } else if (cubeStart) {
+    index = cubeIndex(color);
+  } else {
+    uint32_t best = UINT32_MAX;
+    for (i = 0; i < used; i++) {
+      uint32_t distance = colorDistance(lut[i], color);
+      if (distance < best) {
+        best = distance;
+        index = i;
+      }
+    }
+  }
+
+  lastColor = color;
+  lastIndex = index;
+  lastValid = true;
+  return index;
+}
+
+/**
+ * @brief Change palette entry. Regions that show the entry are marked dirty,
+ *        their pixels stay as they are.
+ * 
+ * @param index 
+ * @param color RGB565
+ */
+void Canvas::setPaletteColor(uint8_t index, uint16_t color) {
+  if (index >= CANVAS_COLORS) {
+    return;
+  }
+
+  lut[index] = color;
+  panelLut[index] = (color >> 8) | (color << 8);
+  if (index >= used) {
+    used = index + 1;
+  }
+  lastValid = false;
+  if (!buffer) {
+    return;
+  }
+
+  int16_t x1 = WIDTH, y1 = HEIGHT, x2 = -1, y2 = -1;
+  for (int16_t y = 0; y < HEIGHT; y++) {
+    for (int16_t x = 0; x < WIDTH; x++) {
+      if (indexAt(buffer, (size_t)y * WIDTH + x) == index) {
+        x1 = min(x1, x);
+        x2 = max(x2, x);
+        y1 = min(y1, y);
+        y2 = y;
+      }
+    }
+  }
+  if (x2 >= 0) {
+    markDirty(x1, y1, x2 - x1 + 1, y2 - y1 + 1);
+  }
+}
+
+/**
+ * @brief Keep the first palette entries when fillScreen() frees the others
+ * 
+ * @param count 
+ */
+void Canvas::reservePalette(uint16_t count) {
+  reserved = min(count, (uint16_t)CANVAS_COLORS);
+  if (used < reserved) {
+    used = reserved;
+  }
+}
+
+/**
+ * @brief Add a colour cube after the entries in use and keep it with them,
+ *        so colours that find no free entry (mostly image pixels) map to
+ *        an evenly spread colour instead of whatever was drawn first.
+ *        Nothing is added at 4bpp.
+ * 
+ */
+void Canvas::reserveColorCube() {
+  if (CANVAS_CUBE_LEVELS == 0 || cubeStart || used + CANVAS_CUBE_SIZE > CANVAS_COLORS) {
+    return;
+  }
+
+  cubeStart = used;
+  for (uint8_t r = 0; r < CANVAS_CUBE_LEVELS; r++) {
+    for (uint8_t g = 0; g < CANVAS_CUBE_LEVELS; g++) {
+      for (uint8_t b = 0; b < CANVAS_CUBE_LEVELS; b++) {
+        uint16_t color = (r * 31 / (CANVAS_CUBE_LEVELS - 1)) << 11 | (g * 63 / (CANVAS_CUBE_LEVELS - 1)) << 5 |
+                         b * 31 / (CANVAS_CUBE_LEVELS - 1);
+        lut[used] = color;
+        panelLut[used] = (color >> 8) | (color << 8);
+        used++;
+      }
+    }
+  }
+  reservePalette(used);
+  lastValid = false;
+}
+
+uint8_t Canvas::getIndex(int16_t x, int16_t y) const {
+  if (!buffer || x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) {
+    return 0;
+  }
+  return indexAt(buffer, (size_t)y * WIDTH + x);
+}
+
+uint16_t Canvas::getPixel(int16_t x, int16_t y) const {
+  return lut[getIndex(x, y)];
+}
+
+void Canvas::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (!buffer || x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) {
+    return;
+  }
+
+  setIndexAt(buffer, (size_t)y * WIDTH + x, colorIndex(color));
+  markDirty(x, y, 1, 1);
+}
+
+/**
+ * @brief Set a clipped rectangle of pixels to one palette index
+ * 
+ * @param x 
+ * @param y 
+ * @param w 
+ * @param h 
+ * @param index 
+ */
+void Canvas::fillIndex(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t index) {
+  for (int16_t j = y; j < y + h; j++) {
+#if CANVAS_BPP == 4
+    size_t p = (size_t)j * WIDTH + x, end = p + w;
+    if (p & 1) {
+      buffer[p >> 1] = (buffer[p >> 1] & 0x0F) | index << 4;
+      p++;
+    }
+    if (end - p >= 2) {
+      memset(&buffer[p >> 1], index | index << 4, (end - p) >> 1);
+      p += (end - p) & ~(size_t)1;
+    }
+    if (p < end) {
+      buffer[p >> 1] = (buffer[p >> 1] & 0xF0) | index;
+    }
+#else
+    memset(&buffer[(size_t)j * WIDTH + x], index, w);
+#endif
+  }
+}
+
+void Canvas::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  if (x < 0) { w += x; x = 0; }
+  if (y < 0) { h += y; y = 0; }
+  if (x + w > WIDTH) w = WIDTH - x;
+  if (y + h > HEIGHT) h = HEIGHT - y;
+  if (!buffer || w <= 0 || h <= 0) {
+    return;
+  }
+
+  fillIndex(x, y, w, h, colorIndex(color));
+  markDirty(x, y, w, h);
+}
+
+/**
+ * @brief Fill whole screen, palette entries above the reserved ones are free
+ *        again afterwards
+ * 
+ * @param color 
+ */
+void Canvas::fillScreen(uint16_t color) {
+  used = max(reserved, (uint16_t)1);
+  lastValid = false;
+  fillRect(0, 0, WIDTH, HEIGHT, color);
+}
+
+void Canvas::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  fillRect(x, y, 1, h, color);
+}
+
+void Canvas::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  fillRect(x, y, w, 1, color);
+}
+
+/**
+ * @brief Copy a horizontal run of pixels into the framebuffer, each colour
+ *        mapped to its palette index
+ * 
+ * @param x 
+ * @param y 
+ * @param colors 
+ * @param w 
+ */
+void Canvas::writeSpan(int16_t x, int16_t y, const uint16_t *colors, int16_t w) {
+  if (x < 0) { colors -= x; w += x; x = 0; }
+  if (x + w > WIDTH) w = WIDTH - x;
+  if (!buffer || y < 0 || y >= HEIGHT || w <= 0) {
+    return;
+  }
+
+  size_t p = (size_t)y * WIDTH + x;
+  for (int16_t i = 0; i < w; i++) {
+    setIndexAt(buffer, p + i, colorIndex(colors[i]));
+  }
+  markDirty(x, y, w, 1);
+}
+
+/**
+ * @brief Draw the set bits of a 1bpp mask in one colour, clear bits are
+ *        left as they are
+ * 
+ * @param x 
+ * @param y 
+ * @param w 
+ * @param h 
+ * @param mask rows of stride bytes, MSB is the leftmost pixel
+ * @param stride 
+ * @param color 
+ */
+void Canvas::drawMask(int16_t x, int16_t y, int16_t w, int16_t h, const uint8_t *mask, int16_t stride, uint16_t color) {
+  int16_t i0 = max((int16_t)0, (int16_t)-x), i1 = min(w, (int16_t)(WIDTH - x));
+  int16_t j0 = max((int16_t)0, (int16_t)-y), j1 = min(h, (int16_t)(HEIGHT - y));
+  if (!buffer || i0 >= i1 || j0 >= j1) {
+    return;
+  }
+
+  uint8_t index = colorIndex(color);
+  for (int16_t j = j0; j < j1; j++) {
+    const uint8_t *row = &mask[j * stride];
+    size_t p = (size_t)(y + j) * WIDTH + x;
+    for (int16_t i = i0; i < i1; i++) {
+      uint8_t bits = row[i >> 3] << (i & 7);
+      if (bits == 0) {
+        i |= 7; // rest of the mask byte is clear
+      } else if (bits & 0x80) {
+        setIndexAt(buffer, p + i, index);
+      }
+    }
+  }
+  markDirty(x + i0, y + j0, i1 - i0, j1 - j0);
+}
+
+/**
+ * @brief Move every row up, rows from the top come back at the bottom
+ * 
+ * @param rows 
+ */
+void Canvas::scrollRows(int16_t rows) {
+  size_t rowBytes = (size_t)WIDTH * CANVAS_BPP / 8;
+
+  rows %= HEIGHT;
+  if (!buffer || rows == 0) {
+    return;
+  }
+  if (rows < 0) {
+    rows += HEIGHT;
+  }
+  std::rotate(buffer, buffer + rows * rowBytes, buffer + bufferSize());
+  markDirty(0, 0, WIDTH, HEIGHT);
+}
+
+/**
+ * @brief Expand a run of pixels to colours of a lookup table
+ * 
+ * @param dst w entries
+ * @param table lut or panelLut
+ * @param x 
+ * @param y 
+ * @param w 
+ */
+void Canvas::expandRow(uint16_t *dst, const uint16_t *table, int16_t x, int16_t y, int16_t w) const {
+  size_t p = (size_t)y * WIDTH + x;
+
+  for (int16_t i = 0; i < w; i++) {
+    dst[i] = table[indexAt(buffer, p + i)];
+  }
+}
+
+/**
+ * @brief LcdDma row source: panel byte order colours straight from the table
+ * 
+ * @param dst 
+ * @param x panel column
+ * @param y panel row
+ * @param w 
+ * @param context RegionSource
+ */
+void Canvas::panelRow(uint16_t *dst, int16_t x, int16_t y, int16_t w, void *context) {
+  const RegionSource *source = (const RegionSource *)context;
+  source->canvas->expandRow(dst, source->canvas->panelLut, x + source->dx, y + source->dy, w);
+}
+
+/**
+ * @brief Count one flushed region in the SPI statistics
+ * 
+ * @param r 
+ */
+void Canvas::countWindow(const DirtyRect &r) {
+  windows++;
+  bytes += CANVAS_WINDOW_BYTES + (uint32_t)r.w * r.h * 2;
+}
+
+/**
+ * @brief Write canvas region r to the display at (x, y) in one address
+ *        window; rows are expanded through the palette into a line buffer,
+ *        CANVAS_LINE_ROWS at a time. The caller holds the transaction, so
+ *        several regions of one panel share a chip select.
+ * 
+ * @param display 
+ * @param r region of the canvas
+ * @param x panel position of the region
+ * @param y 
+ */
+void Canvas::writeRegion(Adafruit_SPITFT &display, const DirtyRect &r, int16_t x, int16_t y) {
+  if (!buffer || !line) {
+    return;
+  }
+
+  int16_t rowsPerChunk = (CANVAS_LINE_ROWS * WIDTH) / r.w;
+
+  display.setAddrWindow(x, y, r.w, r.h);
+  for (int16_t row = 0; row < r.h; row += rowsPerChunk) {
+    int16_t rows = min(rowsPerChunk, (int16_t)(r.h - row));
+    for (int16_t j = 0; j < rows; j++) {
+      expandRow(&line[j * r.w], lut, r.x, r.y + row + j, r.w);
+    }
+    display.writePixels(line, (uint32_t)rows * r.w);
+  }
+  countWindow(r);
+}
+
+/**
+ * @brief Write canvas region r to the panel at (x, y) through DMA. Returns
+ *        when the last chunk is queued.
+ * 
+ * @param lcd 
+ * @param r region of the canvas
+ * @param x panel position of the region
+ * @param y 
+ */
+void Canvas::writeRegion(LcdDma &lcd, const DirtyRect &r, int16_t x, int16_t y) {
+  if (!buffer) {
+    return;
+  }
+
+  RegionSource source = {this, (int16_t)(r.x - x), (int16_t)(r.y - y)};
+  lcd.writeRect(panelRow, &source, x, y, r.w, r.h);
+  countWindow(r);
+}
+
+/**
+ * @brief Send every dirty region to the display, each region in its own
+ *        SPI transaction
+ * 
+ * @param display 
+ */
+void Canvas::flush(Adafruit_SPITFT &display) {
+  for (uint8_t i = 0; i < dirtyCount; i++) {
+    display.startWrite();
+    writeRegion(display, dirty[i], dirty[i].x, dirty[i].y);
+    display.endWrite();
+  }
+  dirtyCount = 0;
+}
+
+/**
+ * @brief Send every dirty region to the display through DMA. Returns when
+ *        the last region is queued.
+ * 
+ * @param lcd 
+ */
+void Canvas::flush(LcdDma &lcd) {
+  for (uint8_t i = 0; i < dirtyCount; i++) {
+    writeRegion(lcd, dirty[i], dirty[i].x, dirty[i].y);
+  }
+  dirtyCount = 0;
+}
@@ -0,0 +1,265 @@
+/**
+ * @file history.cpp
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Undo/redo history of the grid kept as deltas in a byte ring
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#include <string.h>
+#include "history.h"
+
+#define HISTORY_MAGIC 0x5348  // "HS"
+
+/**
+ * @brief Forget all versions, start over from the given cells
+ * 
+ * @param codes cell codes, all empty when NULL
+ */
+void History::reset(const uint8_t *codes) {
+  if (codes) {
+    memcpy(state, codes, sizeof(state));
+  } else {
+    memset(state, 0, sizeof(state));
+  }
+  first = current = last = 0;
+  tail = head = used = 0;
+  changeCount = 0;
+}
+
+/**
+ * @brief Drop the oldest record to make space
+ * 
+ */
+void History::dropOldest() {
+  uint8_t slot = (first + 1) % HISTORY_MAX_RECORDS;
+
+  tail = (tail + length[slot]) % HISTORY_BYTES;
+  used -= length[slot];
+  first++;
+}
+
+/**
+ * @brief Store the cells as a new version if they differ from the current
+ *        one. Versions after the current one (undone steps) are dropped.
+ * 
+ * @param codes cell codes, all empty when NULL
+ * @return true if a version was added
+ */
+bool History::record(const uint8_t *codes) {
+  uint8_t mask[HISTORY_MASK_BYTES] = {0};
+  uint16_t changed = 0;
+
+  for (int i = 0; i < HISTORY_CELLS; i++) {
+    if ((codes ? codes[i] : 0) != state[i]) {
+      mask[i >> 3] |= 1 << (i & 7);
+      changed++;
+    }
+  }
+  if (changed == 0) {
+    return false;
+  }
+
+  while (last > current) {
+    uint8_t slot = last % HISTORY_MAX_RECORDS;
+    head = (head + HISTORY_BYTES - length[slot]) % HISTORY_BYTES;
+    used -= length[slot];
+    last--;
+  }
+
+  uint16_t size = HISTORY_MASK_BYTES + changed;
+  if (size > HISTORY_BYTES) {
+    // Step larger than the whole ring, only the new state can be kept
+    if (codes) {
+      memcpy(state, codes, sizeof(state));
+    } else {
+      memset(state, 0, sizeof(state));
+    }
+    first = current = ++last;
+    tail = head = used = 0;
+    changeCount++;
+    return true;
+  }
+  while (last - first >= HISTORY_MAX_RECORDS || used + size > HISTORY_BYTES) {
+    dropOldest();
+  }
+
+  uint8_t slot = (last + 1) % HISTORY_MAX_RECORDS;
+  start[slot] = head;
+  length[slot] = size;
+  for (int i = 0; i < HISTORY_MASK_BYTES; i++) {
+    ring[head] = mask[i];
+    head = (head + 1) % HISTORY_BYTES;
+  }
+  for (int i = 0; i < HISTORY_CELLS; i++) {
+    uint8_t code = codes ? codes[i] : 0;
+    if (code != state[i]) {
+      ring[head] = state[i] << 4 | code;
+      head = (head + 1) % HISTORY_BYTES;
+      state[i] = code;
+    }
+  }
+  used += size;
+  current = ++last;
+  changeCount++;
+  return true;
+}
+
+/**
+ * @brief Replay the record of a version on the current cells
+ * 
+ * @param version 
+ * @param forward true: to the version, false: back to the one before
+ */
+void History::apply(uint32_t version, bool forward) {
+  uint8_t slot = version % HISTORY_MAX_RECORDS;
+  size_t mask = start[slot];
+  size_t data = mask + HISTORY_MASK_BYTES;
+
+  for (int i = 0; i < HISTORY_CELLS; i++) {
+    if (at(mask + (i >> 3)) & (1 << (i & 7))) {
+      uint8_t step = at(data++);
+      state[i] = forward ? step & 0x0F : step >> 4;
+    }
+  }
+}
+
+/**
+ * @brief Go one version back
+ * 
+ * @return true 
+ * @return false when there is nothing to undo
+ */
+bool History::undo() {
+  if (current == first) {
+    return false;
+  }
+
+  apply(current--, false);
+  changeCount++;
+  return true;
+}
+
+/**
+ * @brief Go one version forward
+ * 
+ * @return true 
+ * @return false when there is nothing to redo
+ */
+bool History::redo() {
+  if (current == last) {
+    return false;
+  }
+
+  apply(++current, true);
+  changeCount++;
+  return true;
+}
+
+/**
+ * @brief Go to any kept version by replaying the records in between
+ * 
+ * @param target 
+ * @return true 
+ * @return false when the version is not kept
+ */
+bool History::seek(uint32_t target) {
+  if (target < first || target > last) {
+    return false;
+  }
+
+  while (current > target) {
+    undo();
+  }
+  while (current < target) {
+    redo();
+  }
+  return true;
+}
+
+/**
+ * @brief Serialize for a flash checkpoint: header, current cells, record
+ *        lengths and the used part of the ring
+ * 
+ * @param out at least HISTORY_SAVE_SIZE bytes
+ * @return size_t bytes written
+ */
+size_t History::save(uint8_t *out) const {
+  uint16_t magic = HISTORY_MAGIC;
+  size_t n = 0;
+
+  memcpy(out + n, &magic, 2); n += 2;
+  memcpy(out + n, &used, 2); n += 2;
+  memcpy(out + n, &first, 4); n += 4;
+  memcpy(out + n, &current, 4); n += 4;
+  memcpy(out + n, &last, 4); n += 4;
+  memcpy(out + n, state, sizeof(state)); n += sizeof(state);
+  for (uint32_t v = first + 1; v <= last; v++) {
+    memcpy(out + n, &length[v % HISTORY_MAX_RECORDS], 2);
+    n += 2;
+  }
+  for (uint16_t i = 0; i < used; i++) {
+    out[n++] = at(tail + i);
+  }
+  return n;
+}
+
+/**
+ * @brief Restore from the output of save()
+ * 
+ * @param in 
+ * @param size 
+ * @return true 
+ * @return false when the data is not a valid checkpoint
+ */
+bool History::load(const uint8_t *in, size_t size) {
+  uint16_t magic, bytes;
+  uint32_t from, version, to;
+
+  if (size < 16 + HISTORY_CELLS) {
+    return false;
+  }
+  memcpy(&magic, in, 2);
+  memcpy(&bytes, in + 2, 2);
+  memcpy(&from, in + 4, 4);
+  memcpy(&version, in + 8, 4);
+  memcpy(&to, in + 12, 4);
+  if (magic != HISTORY_MAGIC || bytes > HISTORY_BYTES || version < from || version > to ||
+      to - from > HISTORY_MAX_RECORDS || size != 16 + HISTORY_CELLS + (to - from) * 2 + bytes) {
+    return false;
+  }
+
+  const uint8_t *lengths = in + 16 + HISTORY_CELLS;
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < to - from; i++) {
+    uint16_t recordSize;
+    memcpy(&recordSize, lengths + i * 2, 2);
+    if (recordSize <= HISTORY_MASK_BYTES) {
+      return false;
+    }
+    total += recordSize;
+  }
+  if (total != bytes) {
+    return false;
+  }
+
+  memcpy(state, in + 16, sizeof(state));
+  uint16_t offset = 0;
+  for (uint32_t v = from + 1; v <= to; v++) {
+    uint8_t slot = v % HISTORY_MAX_RECORDS;
+    memcpy(&length[slot], lengths + (v - from - 1) * 2, 2);
+    start[slot] = offset;
+    offset += length[slot];
+  }
+  memcpy(ring, lengths + (to - from) * 2, bytes);
+
+  first = from;
+  current = version;
+  last = to;
+  tail = 0;
+  head = bytes % HISTORY_BYTES;
+  used = bytes;
+  changeCount = 0;
+  return true;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file image_decoder.cpp
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Incremental decoder of uploaded images (raw RGB565, RLE, QOI)
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#include <string.h>
+#include "image_decoder.h"
+
+#define QOI_HEADER_SIZE 14
+#define QOI_OP_INDEX    0x00
+#define QOI_OP_DIFF     0x40
+#define QOI_OP_LUMA     0x80
+#define QOI_OP_RUN      0xC0
+#define QOI_OP_RGB      0xFE
+#define QOI_OP_RGBA     0xFF
+#define QOI_MASK_2      0xC0
+
+/**
+ * @brief Start decoding a new image
+ * 
+ * @param format 
+ * @param width size for raw formats, maximum size for QOI
+ * @param height 
+ * @param sink 
+ * @param ctx passed to sink
+ */
+void ImageDecoder::begin(ImageFormat format, uint16_t width, uint16_t height, PixelSink sink, void *ctx) {
+  this->format = format;
+  this->sink = sink;
+  this->ctx = ctx;
+  failed = false;
+  maxWidth = w = width;
+  maxHeight = h = height;
+  total = (uint32_t)width * height;
+  emitted = 0;
+  x = y = 0;
+  pendingLength = 0;
+
+  switch (format) {
+  case IMAGE_RGB565:
+    pendingNeed = 2;
+    break;
+  case IMAGE_RLE:
+    pendingNeed = 3;
+    break;
+  case IMAGE_QOI:
+    pendingNeed = QOI_HEADER_SIZE;
+    total = 0;
+    memset(index, 0, sizeof(index));
+    px[0] = px[1] = px[2] = 0;
+    px[3] = 255;
+    break;
+  }
+}
+
+/**
+ * @brief Send count pixels of one colour to the sink
+ * 
+ * @param color 
+ * @param count 
+ */
+void ImageDecoder::emit(uint16_t color, uint32_t count) {
+  if (count > total - emitted) {
+    failed = true;
+    return;
+  }
+
+  emitted += count;
+  while (count--) {
+    sink(x, y, color, ctx);
+    if (++x == w) {
+      x = 0;
+      y++;
+    }
+  }
+}
+
+/**
+ * @brief RGB888 to RGB565
+ * 
+ * @param px 
+ * @return uint16_t 
+ */
+static uint16_t rgb565(const uint8_t *px) {
+  return ((px[0] & 0xF8) << 8) | ((px[1] & 0xFC) << 3) | (px[2] >> 3);
+}
+
+/**
+ * @brief Process one byte of a QOI stream
+ * 
+ * @param byte 
+ * @return false on malformed data
+ */
+bool ImageDecoder::feedQoi(uint8_t byte) {
+  if (pendingLength == 0 && total > 0) {
+    // First byte of an op tells its length
+    if (byte == QOI_OP_RGB) {
+      pendingNeed = 4;
+    } else if (byte == QOI_OP_RGBA) {
+      pendingNeed = 5;
+    } else if ((byte & QOI_MASK_2) == QOI_OP_LUMA) {
+      pendingNeed = 2;
+    } else {
+      pendingNeed = 1;
+    }
+  }
+
+  pending[pendingLength++] = byte;
+  if (pendingLength < pendingNeed) {
+    return true;
+  }
+  pendingLength = 0;
+
+  if (total == 0) {
+    const uint8_t *p = pending;
+    uint32_t width = ((uint32_t)p[4] << 24) | ((uint32_t)p[5] << 16) | (p[6] << 8) | p[7];
+    uint32_t height = ((uint32_t)p[8] << 24) | ((uint32_t)p[9] << 16) | (p[10] << 8) | p[11];
+
+    if (memcmp(p, "qoif", 4) != 0 || width == 0 || height == 0 || width > maxWidth || height > maxHeight) {
+      return false;
+    }
+    w = width;
+    h = height;
+    total = width * height;
+    return true;
+  }
+
+  uint8_t op = pending[0];
+  uint32_t count = 1;
+
+  if (op == QOI_OP_RGB) {
+    memcpy(px, &pending[1], 3);
+  } else if (op == QOI_OP_RGBA) {
+    memcpy(px, &pending[1], 4);
+  } else if ((op & QOI_MASK_2) == QOI_OP_INDEX) {
+    memcpy(px, index[op], 4);
+  } else if ((op & QOI_MASK_2) == QOI_OP_DIFF) {
+    px[0] += ((op >> 4) & 0x03) - 2;
+    px[1] += ((op >> 2) & 0x03) - 2;
+    px[2] += (op & 0x03) - 2;
+  } else if ((op & QOI_MASK_2) == QOI_OP_LUMA) {
+    int vg = (op & 0x3F) - 32;
+    px[0] += vg - 8 + ((pending[1] >> 4) & 0x0F);
+    px[1] += vg;
+    px[2] += vg - 8 + (pending[1] & 0x0F);
+  } else {
+    count = (op & 0x3F) + 1;
+  }
+
+  memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+  emit(rgb565(px), count);
+  return !failed;
+}
+
+/**
+ * @brief Decode next chunk of the image. Data after the last pixel
+ *        (e.g. the QOI end marker) is ignored.
+ * 
+ * @param data 
+ * @param length 
+ * @return false when the data is malformed
+ */
+bool ImageDecoder::feed(const uint8_t *data, size_t length) {
+  for (size_t i = 0; i < length && !failed; i++) {
+    if (total > 0 && emitted == total) {
+      break;
+    }
+
+    if (format == IMAGE_QOI) {
+      failed = !feedQoi(data[i]);
+      continue;
+    }
+
+    pending[pendingLength++] = data[i];
+    if (pendingLength < pendingNeed) {
+      continue;
+    }
+    pendingLength = 0;
+
+    if (format == IMAGE_RGB565) {
+      emit(pending[0] | (pending[1] << 8), 1);
+    } else {
+      emit(pending[1] | (pending[2] << 8), pending[0] + 1);
+    }
+  }
+  return !failed;
+}
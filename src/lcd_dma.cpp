@@ -0,0 +1,225 @@
+/**
+ * @file lcd_dma.cpp
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief DMA driven pixel output to the ST7735 over the ESP-IDF SPI master
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#include <string.h>
+#include <Adafruit_ST7735.h>
+#include <SPI.h>
+#include <driver/gpio.h>
+#include <esp_heap_caps.h>
+#include "lcd_dma.h"
+
+// DC pin of the panel, read by the pre-transfer callback (one panel)
+static int8_t lcdDcPin = -1;
+
+/**
+ * @brief Set DC before a transfer: transaction user is 0 for commands, 1 for data
+ * 
+ * @param t 
+ */
+static void IRAM_ATTR lcdPreTransfer(spi_transaction_t *t) {
+  gpio_set_level((gpio_num_t)lcdDcPin, (int)(intptr_t)t->user);
+}
+
+LcdDma::LcdDma(int8_t sclk, int8_t mosi, int8_t cs, int8_t dc, int16_t xOffset, int16_t yOffset)
+    : sclk(sclk), mosi(mosi), cs(cs), dc(dc), selected(-1), xOffset(xOffset), yOffset(yOffset),
+      width(0), spi(NULL), next(0) {
+  lines[0] = lines[1] = NULL;
+  inFlight[0] = inFlight[1] = false;
+}
+
+/**
+ * @brief Take over the SPI bus and allocate the DMA line buffers.
+ *        On failure the Arduino SPI driver is restored.
+ * 
+ * @param freq SPI clock
+ * @param width widest rectangle that will be written
+ * @return true 
+ * @return false 
+ */
+bool LcdDma::begin(uint32_t freq, int16_t width) {
+  size_t size = (size_t)LCD_DMA_LINES * width * sizeof(uint16_t);
+
+  this->width = width;
+  lines[0] = (uint16_t *)heap_caps_malloc(size, MALLOC_CAP_DMA);
+  lines[1] = (uint16_t *)heap_caps_malloc(size, MALLOC_CAP_DMA);
+  if (!lines[0] || !lines[1]) {
+    heap_caps_free(lines[0]);
+    heap_caps_free(lines[1]);
+    lines[0] = lines[1] = NULL;
+    return false;
+  }
+
+  SPI.end();
+
+  spi_bus_config_t bus;
+  memset(&bus, 0, sizeof(bus));
+  bus.mosi_io_num = mosi;
+  bus.miso_io_num = -1;
+  bus.sclk_io_num = sclk;
+  bus.quadwp_io_num = -1;
+  bus.quadhd_io_num = -1;
+  bus.max_transfer_sz = size;
+
+  spi_device_interface_config_t dev;
+  memset(&dev, 0, sizeof(dev));
+  dev.clock_speed_hz = freq;
+  dev.mode = 0;
+  dev.spics_io_num = cs;
+  dev.queue_size = 2;
+  dev.pre_cb = lcdPreTransfer;
+
+  lcdDcPin = dc;
+  gpio_set_direction((gpio_num_t)dc, GPIO_MODE_OUTPUT);
+
+  if (spi_bus_initialize(VSPI_HOST, &bus, SPI_DMA_CH_AUTO) != ESP_OK ||
+      spi_bus_add_device(VSPI_HOST, &dev, &spi) != ESP_OK) {
+    spi = NULL;
+    SPI.begin();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Wait until DMA is done with line buffer i
+ * 
+ * @param i 
+ */
+void LcdDma::waitBuffer(uint8_t i) {
+  spi_transaction_t *done;
+
+  while (inFlight[i]) {
+    if (spi_device_get_trans_result(spi, &done, portMAX_DELAY) != ESP_OK) {
+      break;
+    }
+    inFlight[done == &trans[0] ? 0 : 1] = false;
+  }
+}
+
+/**
+ * @brief Wait for all queued transfers
+ * 
+ */
+void LcdDma::finish() {
+  waitBuffer(0);
+  waitBuffer(1);
+}
+
+/**
+ * @brief Send a command with parameters. Blocking, short transfers.
+ * 
+ * @param cmd 
+ * @param data 
+ * @param length 
+ */
+void LcdDma::command(uint8_t cmd, const uint8_t *data, uint8_t length) {
+  spi_transaction_t t;
+
+  memset(&t, 0, sizeof(t));
+  t.flags = SPI_TRANS_USE_TXDATA;
+  t.length = 8;
+  t.tx_data[0] = cmd;
+  t.user = (void *)0;
+  spi_device_polling_transmit(spi, &t);
+
+  if (length > 0) {
+    memset(&t, 0, sizeof(t));
+    t.length = length * 8;
+    if (length <= sizeof(t.tx_data)) {
+      t.flags = SPI_TRANS_USE_TXDATA;
+      memcpy(t.tx_data, data, length);
+    } else {
+      t.tx_buffer = data;
+    }
+    t.user = (void *)1;
+    spi_device_polling_transmit(spi, &t);
+  }
+}
+
+/**
+ * @brief Address the panel on CS pin panelCs, releasing the one selected
+ *        before once its queued pixels are out. Does nothing when the
+ *        device has its own chip select.
+ * 
+ * @param panelCs 
+ */
+void LcdDma::select(int8_t panelCs) {
+  if (cs >= 0 || panelCs == selected) {
+    return;
+  }
+
+  finish();
+  if (selected >= 0) {
+    gpio_set_level((gpio_num_t)selected, 1);
+  }
+  gpio_set_direction((gpio_num_t)panelCs, GPIO_MODE_OUTPUT);
+  gpio_set_level((gpio_num_t)panelCs, 0);
+  selected = panelCs;
+}
+
+/**
+ * @brief Send a panel command after the queued pixels
+ * 
+ * @param cmd 
+ * @param data 
+ * @param length 
+ */
+void LcdDma::sendCommand(uint8_t cmd, const uint8_t *data, uint8_t length) {
+  finish();
+  command(cmd, data, length);
+}
+
+/**
+ * @brief Write rectangle of a framebuffer to the same place on the panel.
+ *        Returns as soon as the last chunk is queued; the framebuffer
+ *        itself is never read by DMA.
+ * 
+ * @param source fills the line buffer row by row
+ * @param context passed to source
+ * @param x 
+ * @param y 
+ * @param w at most the width given to begin()
+ * @param h 
+ */
+void LcdDma::writeRect(LcdRowSource source, void *context, int16_t x, int16_t y, int16_t w, int16_t h) {
+  uint16_t x0 = x + xOffset, x1 = x0 + w - 1;
+  uint16_t y0 = y + yOffset, y1 = y0 + h - 1;
+  uint8_t caset[] = {(uint8_t)(x0 >> 8), (uint8_t)x0, (uint8_t)(x1 >> 8), (uint8_t)x1};
+  uint8_t raset[] = {(uint8_t)(y0 >> 8), (uint8_t)y0, (uint8_t)(y1 >> 8), (uint8_t)y1};
+
+  // Commands are polling transfers, which cannot overlap queued ones
+  finish();
+  command(ST77XX_CASET, caset, sizeof(caset));
+  command(ST77XX_RASET, raset, sizeof(raset));
+  command(ST77XX_RAMWR, NULL, 0);
+
+  int16_t rowsPerChunk = (LCD_DMA_LINES * width) / w;
+
+  for (int16_t row = 0; row < h; row += rowsPerChunk) {
+    int16_t rows = min(rowsPerChunk, (int16_t)(h - row));
+    uint16_t *line = lines[next];
+
+    waitBuffer(next);
+
+    for (int16_t j = 0; j < rows; j++) {
+      source(line, x, y + row + j, w, context);
+      line += w;
+    }
+
+    spi_transaction_t &t = trans[next];
+    memset(&t, 0, sizeof(t));
+    t.length = (size_t)rows * w * 16;
+    t.tx_buffer = lines[next];
+    t.user = (void *)1;
+    if (spi_device_queue_trans(spi, &t, portMAX_DELAY) == ESP_OK) {
+      inFlight[next] = true;
+    }
+    next ^= 1;
+  }
+}
@@ -9,498 +9,1809 @@
 
 #include <Adafruit_GFX.h>    // Core graphics library
 #include <Adafruit_ST7735.h> // Hardware-specific library for ST7735
+#include <Preferences.h>
 #include <SPI.h>
 #include <WiFi.h>
 #include <WebServer.h>
+#include <WebSocketsServer.h>
+#include <uri/UriBraces.h>
+#include "animation.h"
+#include "canvas.h"
+#include "command_ring.h"
+#include "grid.h"
+#include "history.h"
+#include "image_decoder.h"
+#include "lcd_dma.h"
+#include "metrics.h"
+#include "panel_array.h"
+#include "screen_mirror.h"
+#include "text_renderer.h"
+#include "index_html.h"
 
 // Port mapping according to display connection
 #define TFT_CS      5
 #define TFT_RST     17 
 #define TFT_DC      2
+#define TFT_SCLK    18
+#define TFT_MOSI    23
+
+#define TFT_SPI_FREQ 27000000
+
+// Position of the 128x128 area in controller RAM (1.44" green tab)
+#define TFT_X_OFFSET 2
+#define TFT_Y_OFFSET 3
+
+#define TFT_WIDTH   128
+#define TFT_HEIGHT  128
+
+// Chip selects of the panels row by row, starting with TFT_CS. All panels
+// share SCLK, MOSI and DC; reset is wired to all, only the first drives it.
+#ifndef PANEL_CS_PINS
+#define PANEL_CS_PINS {TFT_CS}
+#endif
+
+// Canvas tiled across PANEL_COLS x PANEL_ROWS panels
+#define CANVAS_WIDTH  (TFT_WIDTH * PANEL_COLS)
+#define CANVAS_HEIGHT (TFT_HEIGHT * PANEL_ROWS)
+
+// Vertical scrolling: controller RAM rows, commands and the time per row
+// of a text scroll
+#define TFT_RAM_ROWS        162
+#define TFT_VSCRDEF         0x33
+#define TFT_VSCRSADD        0x37
+#define TEXT_SCROLL_STEP_MS 2
+
+// Core of the render task, loop() and the web server run on the other one
+#define RENDER_CORE 0
+#define RENDER_QUEUE_SIZE 64
+
+// Shortest time between two flushes (30 Hz). Updates that arrive in the
+// meantime are drawn to the canvas only and reach the panel together.
+#define RENDER_TICK_MS 33
 
 // WiFi configuration
 const char* ssid = "Dalík";
 const char* password = "123456789";
 
-Adafruit_ST7735 tft = Adafruit_ST7735(TFT_CS, TFT_DC, TFT_RST);
-WebServer server(80);
+// Reconnect to the cached BSSID and channel without scanning, falls back
+// to a scan when that does not associate within WIFI_CACHED_TIMEOUT ms
+#define WIFI_CACHED_TIMEOUT 5000
+#define WIFI_DOT_INTERVAL   500
+// Reuse the last DHCP lease as static address, saves the DHCP exchange
+#define WIFI_REUSE_IP       0
+
+// Undo history is checkpointed to NVS once it has not changed for
+// HISTORY_IDLE_DELAY ms, at most once per HISTORY_CHECKPOINT_INTERVAL ms,
+// and its current version is shown again right after boot
+#define HISTORY_IDLE_DELAY          5000
+#define HISTORY_CHECKPOINT_INTERVAL 30000
+
+constexpr int8_t panelCs[] = PANEL_CS_PINS;
+static_assert(sizeof(panelCs) == PANEL_COUNT && panelCs[0] == TFT_CS, "one chip select per panel, TFT_CS first");
+
+// With several panels, DMA has no CS of its own and selects them by GPIO
+Adafruit_ST7735 tft = Adafruit_ST7735(TFT_CS, TFT_DC, TFT_RST);
+LcdDma lcd(TFT_SCLK, TFT_MOSI, PANEL_COUNT > 1 ? -1 : TFT_CS, TFT_DC, TFT_X_OFFSET, TFT_Y_OFFSET);
+PanelArray panels(PANEL_COLS, PANEL_ROWS, TFT_WIDTH, TFT_HEIGHT);
+WebServer server(80);
+WebSocketsServer webSocket(81);
+Canvas canvas(CANVAS_WIDTH, CANVAS_HEIGHT);
+void scrollPanel(int16_t offset);
+// Hardware scrolling moves whole panels, so text scrolls only when every
+// panel shows the full canvas height
+TextRenderer textRenderer(canvas, PANEL_ROWS == 1 ? scrollPanel : NULL);
+ScreenMirror screen(canvas);
+Grid grid;
+Preferences prefs;
+
+// Connection state, wifiGotIp is written by the WiFi event task
+std::atomic<bool> wifiGotIp(false);
+bool wifiUp = false;
+bool wifiCached = false;
+unsigned long wifiStart = 0;
+unsigned long wifiLastDot = 0;
+bool bootScreenShown = false;  // "Connecting to" with progress dots, until the first connection
+unsigned long serverReadyAt = 0;
+bool firstRequestServed = false;
+
+// Versions of the grid, change counts seen at the last check and saved
+History history;
+uint32_t historySeen = 0;
+uint32_t historySaved = 0;
+unsigned long historyCheckedAt = 0;
+unsigned long historySavedAt = 0;
+
+void recordHistory();
+
+// Colours selectable on the index page, entries can be changed by /cmd.
+// Canvas palette entry 0 is black and entry n + 1 is palette[n], so a cell
+// code is also the canvas index of the cell.
+uint16_t palette[] = {ST7735_RED, ST7735_GREEN, ST7735_BLUE, ST7735_WHITE,
+                      ST7735_YELLOW, ST7735_CYAN, ST7735_MAGENTA, ST7735_ORANGE};
+#define PALETTE_SIZE (int)(sizeof(palette) / sizeof(palette[0]))
+#define WHITE_CODE   4  // palette[3], cells drawn without a colour
+static_assert(PALETTE_SIZE < CANVAS_COLORS && PALETTE_SIZE < 16, "cell codes must fit the canvas palette and 4 bits");
+
+static_assert(INDEX_HTML_GRID_SIZE == GridLayout::SIZE, "index page was built for another GRID_SIZE");
+
+// Binary body of /draw: bitmask (+ colour) or one byte per cell
+#define DRAW_MASK_SIZE  GridLayout::MASK_BYTES
+#define DRAW_CELLS_SIZE GridLayout::CELLS
+
+// Work buffer of the request being served. The server handles one
+// request at a time and checkpoints are taken in loop() between requests.
+union Scratch {
+  uint8_t nextCells[GridLayout::CELLS];       // next grid of /draw, its binary body is received here
+  uint8_t checkpoint[HISTORY_SAVE_SIZE];      // history read from or written to flash
+  uint8_t animationFrame[GridLayout::CELLS];  // last frame of the /animation body
+};
+
+Scratch scratch;
+size_t drawBodyLength = 0;
+
+// Live drawing frames: 3 bytes per cell (x, y, colour code). Changes are
+// broadcast in frames of up to DELTAS_MAX_CELLS cells.
+#define DELTA_SIZE 3
+#define DELTAS_MAX_CELLS (GridLayout::CELLS < 512 ? GridLayout::CELLS : 512)
+
+uint8_t deltas[DELTAS_MAX_CELLS * DELTA_SIZE];
+size_t deltasLength = 0;
+
+// Static buffers that grow with the grid. DRAM also has to hold the WiFi
+// and TCP buffers, the canvas and the DMA line buffers.
+#define GRID_RAM_BUDGET (120 * 1024)
+static_assert(sizeof(Grid) + sizeof(History) + sizeof(Scratch) + sizeof(deltas) + sizeof(Animation) <=
+                  GRID_RAM_BUDGET,
+              "grid buffers do not fit the RAM budget");
+
+// Commands from the network side (loop) to the render task
+enum DrawCommandType : uint8_t {
+  CMD_CLEAR,  // clear screen
+  CMD_CELLS,  // data: up to DRAW_CELLS_PER_CMD cells (x, y, cell code)
+  CMD_TEXT,   // data: text chunk printed at size/colour, DRAW_NEWLINE ends the line
+  CMD_SPAN,   // data: up to DRAW_SPAN_PIXELS pixels (little endian) from x, y to the right
+  CMD_SHAPE,  // flags: display list op, data: two int16 parameters (size, end point or radius)
+  CMD_FLUSH,  // send canvas to the display
+  CMD_PALETTE, // flags: canvas palette index, set to colour
+};
+
+#define DRAW_PAYLOAD        32
+#define DRAW_CELL_SIZE      3
+#define DRAW_CELLS_PER_CMD  (DRAW_PAYLOAD / DRAW_CELL_SIZE)
+#define DRAW_SPAN_PIXELS    (DRAW_PAYLOAD / 2)
+#define DRAW_NEWLINE        0x01
+#define DRAW_AT             0x02  // CMD_TEXT starts at x, y instead of the cursor
+#define DRAW_SCROLL         0x04  // CMD_TEXT scrolls the screen instead of dropping lines below it
+
+struct DrawCommand {
+  uint8_t type;
+  uint8_t length;
+  uint8_t size;
+  uint8_t flags;
+  uint16_t color;
+  int16_t x;
+  int16_t y;
+  uint8_t data[DRAW_PAYLOAD];
+};
+
+CommandRing<DrawCommand, RENDER_QUEUE_SIZE> renderQueue;
+TaskHandle_t renderTaskHandle = NULL;
+DrawCommand pendingCells = {CMD_CELLS, 0, 0, 0, 0, 0, 0, {0}};
+
+// Queue statistics, queued/stalls/highWater are written by loop() only
+uint32_t commandsQueued = 0;
+std::atomic<uint32_t> commandsRendered(0);
+uint32_t queueStalls = 0;
+size_t queueHighWater = 0;
+
+// Flush coalescing, every CMD_FLUSH is one update; written by the render task
+unsigned long renderTickMs = RENDER_TICK_MS;
+unsigned long lastFlushAt = 0;
+std::atomic<bool> flushPending(false);
+std::atomic<uint32_t> updatesRendered(0);
+std::atomic<uint32_t> updatesCoalesced(0);
+
+// Animation playback: the player task ticks at the frame rate, the render
+// task draws the frames that are due and owns animationNext. loop() sets
+// the playback up only while nothing plays.
+#define PLAYER_PRIORITY 2
+
+Animation animation;
+bool animationUploaded = false;  // the request being served has an /animation body
+TaskHandle_t playerTaskHandle = NULL;
+std::atomic<bool> animationPlaying(false);
+std::atomic<bool> animationBusy(false);   // render task is drawing a frame
+std::atomic<uint32_t> framesDue(0);
+std::atomic<uint32_t> framesShown(0);
+std::atomic<uint32_t> framesDropped(0);
+uint32_t animationPeriodMs = 1000 / ANIMATION_DEFAULT_FPS;
+bool animationLoop = true;
+uint16_t animationNext = 0;
+
+// Display list posted to /cmd, little endian, coordinates are int16:
+//   OP_CLEAR
+//   OP_FILL_RECT, OP_RECT  x y w h colour
+//   OP_LINE                x0 y0 x1 y1 colour
+//   OP_CIRCLE, OP_FILL_CIRCLE  x y r colour
+//   OP_TEXT                x y colour size(u8) length(u8) text
+//   OP_BLIT                x y w h, w * h RGB565 pixels
+//   OP_PALETTE             index(u8) colour
+enum DisplayOp : uint8_t {
+  OP_CLEAR,
+  OP_FILL_RECT,
+  OP_RECT,
+  OP_LINE,
+  OP_CIRCLE,
+  OP_FILL_CIRCLE,
+  OP_TEXT,
+  OP_BLIT,
+  OP_PALETTE,
+};
+
+#define CMD_BODY_SIZE 4096
+
+uint8_t cmdBody[CMD_BODY_SIZE];
+size_t cmdBodyLength = 0;
+
+// Request timing, render batches are timed by the render task
+Metrics metrics;
+Histogram renderBatch;
+
+// Upload to /image
+ImageDecoder imageDecoder;
+DrawCommand pendingSpan = {CMD_SPAN, 0, 0, 0, 0, 0, 0, {0}};
+bool imageReceived = false;
+size_t imageBytes = 0;
+unsigned long imageStart = 0;
+
+/**
+ * @brief Clear screen, text continues from the top left corner
+ * 
+ */
+void clearScreen() {
+  canvas.fillScreen(ST7735_BLACK);
+  textRenderer.home();
+}
+
+/**
+ * @brief Draw one grid cell to the canvas by its code, which is also its
+ *        canvas palette index
+ * 
+ * @param x 
+ * @param y 
+ * @param code 
+ */
+void drawCell(int x, int y, uint8_t code) {
+  canvas.fillCell<GridLayout::CELL>(x, y, code);
+}
+
+/**
+ * @brief Execute one command, render task side
+ * 
+ * @param cmd 
+ */
+void renderCommand(const DrawCommand &cmd) {
+  // Everything but scrolling text expects canvas rows to match the screen
+  if (cmd.type != CMD_TEXT) {
+    textRenderer.endWord();
+  }
+  if (cmd.type != CMD_FLUSH && cmd.type != CMD_PALETTE && !(cmd.type == CMD_TEXT && (cmd.flags & DRAW_SCROLL))) {
+    textRenderer.resetScroll(cmd.type != CMD_CLEAR);
+  }
+
+  switch (cmd.type) {
+  case CMD_CLEAR:
+    clearScreen();
+    break;
+  case CMD_CELLS:
+    for (int i = 0; i < cmd.length; i += DRAW_CELL_SIZE) {
+      drawCell(cmd.data[i], cmd.data[i + 1], cmd.data[i + 2]);
+    }
+    break;
+  case CMD_TEXT:
+    if (cmd.flags & DRAW_AT) {
+      textRenderer.moveTo(cmd.x, cmd.y);
+    }
+    textRenderer.setStyle(cmd.size, cmd.color);
+    textRenderer.setScroll(cmd.flags & DRAW_SCROLL);
+    textRenderer.write(cmd.data, cmd.length);
+    if (cmd.flags & DRAW_NEWLINE) {
+      textRenderer.newline();
+    }
+    break;
+  case CMD_SPAN: {
+    uint16_t colors[DRAW_SPAN_PIXELS];
+    memcpy(colors, cmd.data, cmd.length);
+    canvas.writeSpan(cmd.x, cmd.y, colors, cmd.length / 2);
+    break;
+  }
+  case CMD_SHAPE: {
+    int16_t p[2];
+    memcpy(p, cmd.data, sizeof(p));
+    switch (cmd.flags) {
+    case OP_FILL_RECT:
+      canvas.fillRect(cmd.x, cmd.y, p[0], p[1], cmd.color);
+      break;
+    case OP_RECT:
+      canvas.drawRect(cmd.x, cmd.y, p[0], p[1], cmd.color);
+      break;
+    case OP_LINE:
+      canvas.drawLine(cmd.x, cmd.y, p[0], p[1], cmd.color);
+      break;
+    case OP_CIRCLE:
+      canvas.drawCircle(cmd.x, cmd.y, p[0], cmd.color);
+      break;
+    case OP_FILL_CIRCLE:
+      canvas.fillCircle(cmd.x, cmd.y, p[0], cmd.color);
+      break;
+    default:
+      break;
+    }
+    break;
+  }
+  case CMD_PALETTE:
+    canvas.setPaletteColor(cmd.flags, cmd.color);
+    break;
+  case CMD_FLUSH:
+    if (flushPending.load(std::memory_order_relaxed)) {
+      updatesCoalesced.fetch_add(1, std::memory_order_relaxed);
+    }
+    flushPending.store(true, std::memory_order_release);
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief Execute all queued commands
+ * 
+ * @return size_t number of executed commands
+ */
+size_t renderStep() {
+  DrawCommand cmd;
+  size_t count = 0;
+
+  while (renderQueue.pop(cmd)) {
+    renderCommand(cmd);
+    commandsRendered.fetch_add(1, std::memory_order_release);
+    count++;
+  }
+  return count;
+}
+
+/**
+ * @brief Send the dirty regions of the canvas to the panels
+ * 
+ */
+void sendCanvas() {
+  screen.notifyCanvas();
+  panels.flush(canvas);
+}
+
+/**
+ * @brief Send the canvas to the display, render task side
+ * 
+ */
+void flushCanvas() {
+  sendCanvas();
+  lastFlushAt = millis();
+  updatesRendered.fetch_add(1, std::memory_order_relaxed);
+  flushPending.store(false, std::memory_order_release);
+}
+
+/**
+ * @brief Scroll the panels so canvas row offset is at the top, render
+ *        task side. Rows changed so far are flushed first, the scroll start
+ *        only moves what the panels show. Rows are paced only while no
+ *        command waits, so a long text never keeps the queue full.
+ * 
+ * @param offset 
+ */
+void scrollPanel(int16_t offset) {
+  uint16_t first = TFT_Y_OFFSET + offset;
+  uint8_t area[] = {0, TFT_Y_OFFSET, 0, TFT_HEIGHT, 0, TFT_RAM_ROWS - TFT_HEIGHT - TFT_Y_OFFSET};
+  uint8_t start[] = {(uint8_t)(first >> 8), (uint8_t)first};
+
+  sendCanvas();
+  panels.sendCommand(TFT_VSCRDEF, area, sizeof(area));
+  panels.sendCommand(TFT_VSCRSADD, start, sizeof(start));
+  screen.setScroll(offset);
+  if (offset != 0 && renderQueue.size() == 0) {
+    vTaskDelay(pdMS_TO_TICKS(TEXT_SCROLL_STEP_MS));
+  }
+}
+
+/**
+ * @brief Draw the next record of the animation, render task side
+ * 
+ * @return false when a non-looping animation has ended
+ */
+bool drawAnimationRecord() {
+  uint16_t frames = animation.frameCount();
+  AnimationCursor cursor = animation.read(animationNext);
+  uint16_t cell;
+  uint8_t code;
+
+  while (animation.next(cursor, cell, code)) {
+    drawCell(cell % GridLayout::SIZE, cell / GridLayout::SIZE, code);
+  }
+
+  if (animationNext + 1 < frames) {
+    animationNext++;
+  } else if (animationNext + 1 == frames) {
+    if (!animationLoop) {
+      return false;
+    }
+    animationNext = frames;  // record back to the first frame
+  } else {
+    animationNext = frames > 1 ? 1 : frames;
+  }
+  return true;
+}
+
+/**
+ * @brief Show the frames that are due, render task side. Frames that came
+ *        due while the task was late are drawn to the canvas but only the
+ *        newest reaches the panel; the others count as dropped.
+ * 
+ */
+void playFrames() {
+  uint32_t due = framesDue.exchange(0, std::memory_order_acquire);
+  if (due == 0) {
+    return;
+  }
+
+  animationBusy.store(true);
+  if (animationPlaying.load()) {
+    uint32_t drawn = 0;
+    while (drawn < due) {
+      drawn++;
+      if (!drawAnimationRecord()) {
+        animationPlaying.store(false);
+        break;
+      }
+    }
+    flushCanvas();
+    framesShown.fetch_add(1, std::memory_order_relaxed);
+    framesDropped.fetch_add(drawn - 1, std::memory_order_relaxed);
+  }
+  animationBusy.store(false);
+}
+
+/**
+ * @brief Player task: wakes the render task once per frame period while an
+ *        animation plays. Periods are counted from the start, so a late
+ *        wake-up does not shift the later frames.
+ * 
+ * @param param 
+ */
+void playerTask(void *param) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    TickType_t wake = xTaskGetTickCount();
+    while (animationPlaying.load(std::memory_order_acquire)) {
+      vTaskDelayUntil(&wake, pdMS_TO_TICKS(animationPeriodMs));
+      framesDue.fetch_add(1, std::memory_order_release);
+      xTaskNotifyGive(renderTaskHandle);
+    }
+  }
+}
+
+/**
+ * @brief Render task, the only code that touches the canvas and SPI bus.
+ *        Sleeps until loop() notifies it about new commands or a pending
+ *        flush is due. Flushes at most once per render tick, so a burst
+ *        of updates costs one transfer of the final state.
+ * 
+ * @param param 
+ */
+void renderTask(void *param) {
+  for (;;) {
+    TickType_t wait = portMAX_DELAY;
+    if (flushPending.load(std::memory_order_relaxed)) {
+      unsigned long since = millis() - lastFlushAt;
+      wait = since >= renderTickMs ? 0 : pdMS_TO_TICKS(renderTickMs - since);
+    }
+    ulTaskNotifyTake(pdTRUE, wait);
+
+    uint32_t start = ESP.getCycleCount();
+    renderStep();
+    playFrames();
+    if (flushPending.load(std::memory_order_relaxed) && millis() - lastFlushAt >= renderTickMs) {
+      flushCanvas();
+    }
+    renderBatch.add(ESP.getCycleCount() - start);
+  }
+}
+
+/**
+ * @brief Commands queued but not rendered yet
+ * 
+ * @return uint32_t 
+ */
+uint32_t renderBacklog() {
+  return commandsQueued - commandsRendered.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Stop the animation and wait until the render task is done with
+ *        the frame it may be drawing, so the frames can be replaced
+ * 
+ */
+void stopAnimation() {
+  animationPlaying.store(false);
+  while (animationBusy.load()) {
+    vTaskDelay(1);
+  }
+}
+
+/**
+ * @brief Queue command for the render task. Waits only when the queue is
+ *        full, i.e. the display cannot keep up. Anything drawn stops the
+ *        animation.
+ * 
+ * @param cmd 
+ */
+void queueCommand(const DrawCommand &cmd) {
+  if (animationPlaying.load(std::memory_order_relaxed)) {
+    stopAnimation();
+  }
+  while (!renderQueue.push(cmd)) {
+    queueStalls++;
+    xTaskNotifyGive(renderTaskHandle);
+    vTaskDelay(1);
+  }
+
+  commandsQueued++;
+  queueHighWater = max(queueHighWater, renderQueue.size());
+}
+
+/**
+ * @brief Queue cells collected so far
+ * 
+ */
+void queuePendingCells() {
+  if (pendingCells.length > 0) {
+    queueCommand(pendingCells);
+    pendingCells.length = 0;
+  }
+}
+
+/**
+ * @brief Queue screen clear. The grid is no longer shown afterwards.
+ * 
+ */
+void queueClear() {
+  DrawCommand cmd = {CMD_CLEAR, 0, 0, 0, 0, 0, 0, {0}};
+
+  queuePendingCells();
+  grid.invalidate();
+  queueCommand(cmd);
+}
+
+/**
+ * @brief Queue one grid cell, cells are sent to the render task in batches
+ * 
+ * @param x 
+ * @param y 
+ * @param code cell code, drawn as that canvas palette index
+ */
+void queueCell(int x, int y, uint8_t code) {
+  uint8_t *cell = &pendingCells.data[pendingCells.length];
+
+  cell[0] = x;
+  cell[1] = y;
+  cell[2] = code;
+  pendingCells.length += DRAW_CELL_SIZE;
+
+  if (pendingCells.length == DRAW_CELLS_PER_CMD * DRAW_CELL_SIZE) {
+    queuePendingCells();
+  }
+}
+
+/**
+ * @brief Queue text printed at the cursor, split into command sized chunks
+ * 
+ * @param text 
+ * @param size 
+ * @param color 
+ * @param newline end the line after the text
+ * @param scroll scroll the screen when the text reaches the bottom
+ */
+void queueText(const char *text, uint8_t size, uint16_t color, bool newline, bool scroll) {
+  DrawCommand cmd = {CMD_TEXT, 0, size, 0, color, 0, 0, {0}};
+  size_t length = strlen(text);
+
+  queuePendingCells();
+  do {
+    cmd.length = min(length, (size_t)DRAW_PAYLOAD);
+    memcpy(cmd.data, text, cmd.length);
+    text += cmd.length;
+    length -= cmd.length;
+    cmd.flags = (newline && length == 0) ? DRAW_NEWLINE : 0;
+    if (scroll) {
+      cmd.flags |= DRAW_SCROLL;
+    }
+    queueCommand(cmd);
+  } while (length > 0);
+}
+
+/**
+ * @brief End of a batch: queue canvas flush and wake up the render task
+ * 
+ */
+void queueFlush() {
+  DrawCommand cmd = {CMD_FLUSH, 0, 0, 0, 0, 0, 0, {0}};
+
+  queuePendingCells();
+  queueCommand(cmd);
+  xTaskNotifyGive(renderTaskHandle);
+}
+
+/**
+ * @brief Print formated text
+ * 
+ * @param label 
+ * @param text 
+ */
+void printText(const char* label, const char *text) {
+  queueClear();
+  queueText(label, 1, ST7735_WHITE, true, false);
+  queueText(text, 2, ST7735_GREEN, true, false);
+  queueFlush();
+}
+
+
+/**
+ * @brief WiFi event task callback, hands the state over to loop()
+ * 
+ * @param event 
+ */
+void wifiEvent(arduino_event_id_t event) {
+  if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+    wifiGotIp = true;
+  } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+    wifiGotIp = false;
+  }
+}
+
+/**
+ * @brief Start connecting to wifi and return. Uses the BSSID and channel
+ *        of the last association when they are cached in NVS.
+ * 
+ */
+void connectToWifi() {
+  uint8_t bssid[6];
+
+  WiFi.mode(WIFI_STA);
+  WiFi.onEvent(wifiEvent);
+  wifiStart = millis();
+
+  prefs.begin("wifi", true);
+  wifiCached = prefs.getBytes("bssid", bssid, sizeof(bssid)) == sizeof(bssid) && prefs.getUChar("channel") > 0;
+#if WIFI_REUSE_IP
+  if (wifiCached && prefs.getUInt("ip") != 0) {
+    WiFi.config(IPAddress(prefs.getUInt("ip")), IPAddress(prefs.getUInt("gateway")),
+                IPAddress(prefs.getUInt("subnet")), IPAddress(prefs.getUInt("dns")));
+  }
+#endif
+  if (wifiCached) {
+    WiFi.begin(ssid, password, prefs.getUChar("channel"), bssid);
+  } else {
+    WiFi.begin(ssid, password);
+  }
+  prefs.end();
+}
+
+/**
+ * @brief Remember BSSID, channel and address of the current association,
+ *        NVS is written only when they changed
+ * 
+ */
+void saveWifiCache() {
+  uint8_t bssid[6] = {0};
+
+  prefs.begin("wifi", false);
+  prefs.getBytes("bssid", bssid, sizeof(bssid));
+  if (memcmp(bssid, WiFi.BSSID(), sizeof(bssid)) != 0 || prefs.getUChar("channel") != WiFi.channel()) {
+    prefs.putBytes("bssid", WiFi.BSSID(), sizeof(bssid));
+    prefs.putUChar("channel", WiFi.channel());
+  }
+  if (prefs.getUInt("ip") != (uint32_t)WiFi.localIP()) {
+    prefs.putUInt("ip", WiFi.localIP());
+    prefs.putUInt("gateway", WiFi.gatewayIP());
+    prefs.putUInt("subnet", WiFi.subnetMask());
+    prefs.putUInt("dns", WiFi.dnsIP());
+  }
+  prefs.end();
+}
+
+/**
+ * @brief Follow the connection from loop(): print progress and the address
+ *        until the first connection, fall back to a scan when the cached
+ *        BSSID does not answer. Later drops leave the screen alone.
+ * 
+ */
+void checkWifi() {
+  bool up = wifiGotIp;
+
+  if (up && !wifiUp) {
+    wifiUp = true;
+    Serial.printf("wifi: connected %lu ms after boot (%s), %s\n", millis(),
+                  wifiCached ? "cached BSSID" : "scan", WiFi.localIP().toString().c_str());
+    saveWifiCache();
+    if (bootScreenShown) {
+      bootScreenShown = false;
+      printText("Connected!", WiFi.localIP().toString().c_str());
+    }
+    return;
+  }
+  if (up) {
+    return;
+  }
+
+  if (wifiUp) {
+    wifiUp = false;
+    wifiStart = millis();
+  }
+  if (wifiCached && millis() - wifiStart > WIFI_CACHED_TIMEOUT) {
+    Serial.println("wifi: cached BSSID did not answer, scanning");
+    wifiCached = false;
+    wifiStart = millis();
+    WiFi.disconnect();
+    WiFi.begin(ssid, password);
+  }
+  if (bootScreenShown && millis() - wifiLastDot >= WIFI_DOT_INTERVAL) {
+    wifiLastDot = millis();
+    queueText(".", 2, ST7735_GREEN, false, false);
+    queueFlush();
+  }
+}
+
+/**
+ * @brief Load index page. The page is stored gzip compressed in flash and
+ *        revalidated by the browser with its ETag, so repeated loads are 304.
+ * 
+ */
+void indexPageAction() {
+  metrics.phase(PHASE_SEND);
+  server.sendHeader("ETag", INDEX_HTML_ETAG);
+  server.sendHeader("Cache-Control", "no-cache");
+
+  if (server.header("If-None-Match") == INDEX_HTML_ETAG) {
+    server.send(304);
+    return;
+  }
+
+  server.sendHeader("Content-Encoding", "gzip");
+  server.send_P(200, "text/html", (const char *)INDEX_HTML_GZ, sizeof(INDEX_HTML_GZ));
+}
+
+/**
+ * @brief Display text, word wrapped. With scroll=1 long text scrolls the
+ *        screen up, otherwise lines below it are dropped. Answers 204 so
+ *        the page (or a plain form post) stays where it is.
+ * 
+ */
+void displayTextAction() {
+  String text = server.arg("text");
+
+  metrics.phase(PHASE_RENDER);
+  queueClear();
+  queueText(text.c_str(), 2, ST7735_WHITE, true, server.arg("scroll") == "1");
+  queueFlush();
+  recordHistory();
+
+  metrics.phase(PHASE_SEND);
+  server.sendHeader("X-Render-Backlog", String(renderBacklog()));
+  server.send(204);
+}
+
+/**
+ * @brief Fill next grid from form fields "y-x"=on and textColor,
+ *        walking the argument list once
+ * 
+ * @return true 
+ * @return false when textColor is not a palette index
+ */
+bool parseDrawForm() {
+  uint8_t code = WHITE_CODE;
+
+  memset(scratch.nextCells, 0, sizeof(scratch.nextCells));
+  if (server.hasArg("textColor")) {
+    long index = server.arg("textColor").toInt();
+    if (index < 0 || index >= PALETTE_SIZE) {
+      return false;
+    }
+    code = index + 1;
+  }
+
+  for (int i = 0; i < server.args(); i++) {
+    int x, y;
+    if (sscanf(server.argName(i).c_str(), "%d-%d", &y, &x) == 2 &&
+        x >= 0 && x < GridLayout::SIZE && y >= 0 && y < GridLayout::SIZE) {
+      scratch.nextCells[y * GridLayout::SIZE + x] = code;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Turn the binary body received into the next grid buffer into
+ *        cell codes, in place. Accepted layouts:
+ *        - MASK_BYTES bitmask (32 B at 16x16), bit (y * SIZE + x) LSB
+ *          first, optional extra byte with palette index (white when missing)
+ *        - CELLS bytes (256 B at 16x16), one per cell: 0 = empty,
+ *          n = palette index n - 1
+ * 
+ * @return true 
+ * @return false when the body has an unknown size or colour
+ */
+bool parseDrawBody() {
+  uint8_t *cells = scratch.nextCells;
+
+  if (drawBodyLength == DRAW_MASK_SIZE || drawBodyLength == DRAW_MASK_SIZE + 1) {
+    if (drawBodyLength > DRAW_MASK_SIZE && cells[DRAW_MASK_SIZE] >= PALETTE_SIZE) {
+      return false;
+    }
+    uint8_t code = drawBodyLength > DRAW_MASK_SIZE ? cells[DRAW_MASK_SIZE] + 1 : WHITE_CODE;
+
+    // Backwards, so bit i is read from byte i / 8 before that byte is written
+    for (int i = GridLayout::CELLS - 1; i >= 0; i--) {
+      cells[i] = cells[i >> 3] & (1 << (i & 7)) ? code : 0;
+    }
+    return true;
+  }
+
+  if (drawBodyLength == DRAW_CELLS_SIZE) {
+    for (int i = 0; i < GridLayout::CELLS; i++) {
+      if (cells[i] > PALETTE_SIZE) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * @brief Make sure the display shows the grid before cells are painted
+ * 
+ */
+void prepareGrid() {
+  if (!grid.isValid()) {
+    queueClear();
+    grid.reset();
+  }
+}
+
+/**
+ * @brief Send queued cell changes to all WebSocket clients
+ * 
+ */
+void broadcastDeltas() {
+  if (deltasLength > 0) {
+    webSocket.broadcastBIN(deltas, deltasLength);
+    deltasLength = 0;
+  }
+}
+
+/**
+ * @brief Paint one cell if its code changed and queue it for broadcast
+ * 
+ * @param x 
+ * @param y 
+ * @param code 
+ * @return true if the cell changed
+ */
+bool paintCell(int x, int y, uint8_t code) {
+  if (!grid.set(x, y, code)) {
+    return false;
+  }
+
+  queueCell(x, y, code);
+  deltas[deltasLength++] = x;
+  deltas[deltasLength++] = y;
+  deltas[deltasLength++] = code;
+  if (deltasLength == sizeof(deltas)) {
+    broadcastDeltas();
+  }
+  return true;
+}
+
+/**
+ * @brief Repaint cells of next grid that differ from the displayed grid
+ * 
+ * @return int number of changed cells
+ */
+int commitCells() {
+  int changed = 0;
+
+  prepareGrid();
+  for (int y = 0; y < GridLayout::SIZE; y++) {
+    for (int x = 0; x < GridLayout::SIZE; x++) {
+      if (paintCell(x, y, scratch.nextCells[y * GridLayout::SIZE + x])) {
+        changed++;
+      }
+    }
+  }
+  queueFlush();
+  broadcastDeltas();
+  recordHistory();
+
+  return changed;
+}
 
 /**
- * @brief Html code of index page
- * 
- * @return const char* 
- */
-const char* htmlCode() {
-  return "<!DOCTYPE html> \
-          <html lang='en'> \
-          <head> \
-            <meta charset='UTF-8'> \
-            <meta http-equiv='X-UA-Compatible' content='IE=edge'> \
-            <meta name='viewport' content='width=device-width, initial-scale=1.0'> \
-            <title>ESP32 Server</title> \
-            <style> \
-              * { \
-                  box-sizing: border-box; \
-              } \
-              \
-              .container { \
-                  display: grid; \
-                  grid-template-rows: repeat(16, 30px); \
-                  grid-template-columns: repeat(16, 30px); \
-                  row-gap: 0; \
-              } \
-              input[type='checkbox'] { \
-                  appearance: none; \
-                  display: grid; \
-                  margin: 0; \
-              } \
-              input[type='checkbox']::before { \
-                  content: ' '; \
-                  position: relative; \
-                  width: 28px; \
-                  height: 28px; \
-                  border: 1px solid black; \
-                  cursor: pointer; \
-              } \
-              input[type='checkbox']:checked::before { \
-                  background-color: aquamarine; \
-              } \
-            </style> \
-          </head> \
-          <body> \
-            <form method='POST' action='/text'> \
-              <label>Text: </label> \
-              <input type='text' name='text'/> \
-              <input type='submit' name='btn-send' value='Write'/> \
-              </form> \
-              <br> \
-              <form action='/draw' method='POST'> \
-                <div class='container'> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-0' id=''> \
-                      <input type='checkbox' name='1-0' id=''> \
-                      <input type='checkbox' name='2-0' id=''> \
-                      <input type='checkbox' name='3-0' id=''> \
-                      <input type='checkbox' name='4-0' id=''> \
-                      <input type='checkbox' name='5-0' id=''> \
-                      <input type='checkbox' name='6-0' id=''> \
-                      <input type='checkbox' name='7-0' id=''> \
-                      <input type='checkbox' name='8-0' id=''> \
-                      <input type='checkbox' name='9-0' id=''> \
-                      <input type='checkbox' name='10-0' id=''> \
-                      <input type='checkbox' name='11-0' id=''> \
-                      <input type='checkbox' name='12-0' id=''> \
-                      <input type='checkbox' name='13-0' id=''> \
-                      <input type='checkbox' name='14-0' id=''> \
-                      <input type='checkbox' name='15-0' id=''> \
-                    </div> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-1' id=''> \
-                      <input type='checkbox' name='1-1' id=''> \
-                      <input type='checkbox' name='2-1' id=''> \
-                      <input type='checkbox' name='3-1' id=''> \
-                      <input type='checkbox' name='4-1' id=''> \
-                      <input type='checkbox' name='5-1' id=''> \
-                      <input type='checkbox' name='6-1' id=''> \
-                      <input type='checkbox' name='7-1' id=''> \
-                      <input type='checkbox' name='8-1' id=''> \
-                      <input type='checkbox' name='9-1' id=''> \
-                      <input type='checkbox' name='10-1' id=''> \
-                      <input type='checkbox' name='11-1' id=''> \
-                      <input type='checkbox' name='12-1' id=''> \
-                      <input type='checkbox' name='13-1' id=''> \
-                      <input type='checkbox' name='14-1' id=''> \
-                      <input type='checkbox' name='15-1' id=''> \
-                    </div> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-2' id=''> \
-                      <input type='checkbox' name='1-2' id=''> \
-                      <input type='checkbox' name='2-2' id=''> \
-                      <input type='checkbox' name='3-2' id=''> \
-                      <input type='checkbox' name='4-2' id=''> \
-                      <input type='checkbox' name='5-2' id=''> \
-                      <input type='checkbox' name='6-2' id=''> \
-                      <input type='checkbox' name='7-2' id=''> \
-                      <input type='checkbox' name='8-2' id=''> \
-                      <input type='checkbox' name='9-2' id=''> \
-                      <input type='checkbox' name='10-2' id=''> \
-                      <input type='checkbox' name='11-2' id=''> \
-                      <input type='checkbox' name='12-2' id=''> \
-                      <input type='checkbox' name='13-2' id=''> \
-                      <input type='checkbox' name='14-2' id=''> \
-                      <input type='checkbox' name='15-2' id=''> \
-                    </div> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-3' id=''> \
-                      <input type='checkbox' name='1-3' id=''> \
-                      <input type='checkbox' name='2-3' id=''> \
-                      <input type='checkbox' name='3-3' id=''> \
-                      <input type='checkbox' name='4-3' id=''> \
-                      <input type='checkbox' name='5-3' id=''> \
-                      <input type='checkbox' name='6-3' id=''> \
-                      <input type='checkbox' name='7-3' id=''> \
-                      <input type='checkbox' name='8-3' id=''> \
-                      <input type='checkbox' name='9-3' id=''> \
-                      <input type='checkbox' name='10-3' id=''> \
-                      <input type='checkbox' name='11-3' id=''> \
-                      <input type='checkbox' name='12-3' id=''> \
-                      <input type='checkbox' name='13-3' id=''> \
-                      <input type='checkbox' name='14-3' id=''> \
-                      <input type='checkbox' name='15-3' id=''> \
-                    </div> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-4' id=''> \
-                      <input type='checkbox' name='1-4' id=''> \
-                      <input type='checkbox' name='2-4' id=''> \
-                      <input type='checkbox' name='3-4' id=''> \
-                      <input type='checkbox' name='4-4' id=''> \
-                      <input type='checkbox' name='5-4' id=''> \
-                      <input type='checkbox' name='6-4' id=''> \
-                      <input type='checkbox' name='7-4' id=''> \
-                      <input type='checkbox' name='8-4' id=''> \
-                      <input type='checkbox' name='9-4' id=''> \
-                      <input type='checkbox' name='10-4' id=''> \
-                      <input type='checkbox' name='11-4' id=''> \
-                    <input type='checkbox' name='12-4' id=''> \
-                      <input type='checkbox' name='13-4' id=''> \
-                      <input type='checkbox' name='14-4' id=''> \
-                      <input type='checkbox' name='15-4' id=''> \
-                    </div> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-5' id=''> \
-                      <input type='checkbox' name='1-5' id=''> \
-                      <input type='checkbox' name='2-5' id=''> \
-                      <input type='checkbox' name='3-5' id=''> \
-                      <input type='checkbox' name='4-5' id=''> \
-                      <input type='checkbox' name='5-5' id=''> \
-                      <input type='checkbox' name='6-5' id=''> \
-                      <input type='checkbox' name='7-5' id=''> \
-                      <input type='checkbox' name='8-5' id=''> \
-                      <input type='checkbox' name='9-5' id=''> \
-                      <input type='checkbox' name='10-5' id=''> \
-                      <input type='checkbox' name='11-5' id=''> \
-                      <input type='checkbox' name='12-5' id=''> \
-                      <input type='checkbox' name='13-5' id=''> \
-                      <input type='checkbox' name='14-5' id=''> \
-                      <input type='checkbox' name='15-5' id=''> \
-                    </div> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-6' id=''> \
-                      <input type='checkbox' name='1-6' id=''> \
-                      <input type='checkbox' name='2-6' id=''> \
-                      <input type='checkbox' name='3-6' id=''> \
-                      <input type='checkbox' name='4-6' id=''> \
-                      <input type='checkbox' name='5-6' id=''> \
-                      <input type='checkbox' name='6-6' id=''> \
-                      <input type='checkbox' name='7-6' id=''> \
-                      <input type='checkbox' name='8-6' id=''> \
-                      <input type='checkbox' name='9-6' id=''> \
-                      <input type='checkbox' name='10-6' id=''> \
-                      <input type='checkbox' name='11-6' id=''> \
-                      <input type='checkbox' name='12-6' id=''> \
-                      <input type='checkbox' name='13-6' id=''> \
-                      <input type='checkbox' name='14-6' id=''> \
-                      <input type='checkbox' name='15-6' id=''> \
-                    </div> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-7' id=''> \
-                      <input type='checkbox' name='1-7' id=''> \
-                      <input type='checkbox' name='2-7' id=''> \
-                      <input type='checkbox' name='3-7' id=''> \
-                      <input type='checkbox' name='4-7' id=''> \
-                      <input type='checkbox' name='5-7' id=''> \
-                      <input type='checkbox' name='6-7' id=''> \
-                      <input type='checkbox' name='7-7' id=''> \
-                      <input type='checkbox' name='8-7' id=''> \
-                      <input type='checkbox' name='9-7' id=''> \
-                      <input type='checkbox' name='10-7' id=''> \
-                      <input type='checkbox' name='11-7' id=''> \
-                      <input type='checkbox' name='12-7' id=''> \
-                      <input type='checkbox' name='13-7' id=''> \
-                      <input type='checkbox' name='14-7' id=''> \
-                      <input type='checkbox' name='15-7' id=''> \
-                    </div> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-8' id=''> \
-                    <input type='checkbox' name='1-8' id=''> \
-                      <input type='checkbox' name='2-8' id=''> \
-                      <input type='checkbox' name='3-8' id=''> \
-                      <input type='checkbox' name='4-8' id=''> \
-                      <input type='checkbox' name='5-8' id=''> \
-                      <input type='checkbox' name='6-8' id=''> \
-                      <input type='checkbox' name='7-8' id=''> \
-                      <input type='checkbox' name='8-8' id=''> \
-                      <input type='checkbox' name='9-8' id=''> \
-                      <input type='checkbox' name='10-8' id=''> \
-                      <input type='checkbox' name='11-8' id=''> \
-                      <input type='checkbox' name='12-8' id=''> \
-                      <input type='checkbox' name='13-8' id=''> \
-                      <input type='checkbox' name='14-8' id=''> \
-                      <input type='checkbox' name='15-8' id=''> \
-                    </div> \
-                    <div class='row'> \
-                    <input type='checkbox' name='0-9' id=''> \
-                      <input type='checkbox' name='1-9' id=''> \
-                      <input type='checkbox' name='2-9' id=''> \
-                      <input type='checkbox' name='3-9' id=''> \
-                      <input type='checkbox' name='4-9' id=''> \
-                      <input type='checkbox' name='5-9' id=''> \
-                      <input type='checkbox' name='6-9' id=''> \
-                      <input type='checkbox' name='7-9' id=''> \
-                      <input type='checkbox' name='8-9' id=''> \
-                      <input type='checkbox' name='9-9' id=''> \
-                      <input type='checkbox' name='10-9' id=''> \
-                      <input type='checkbox' name='11-9' id=''> \
-                      <input type='checkbox' name='12-9' id=''> \
-                      <input type='checkbox' name='13-9' id=''> \
-                      <input type='checkbox' name='14-9' id=''> \
-                      <input type='checkbox' name='15-9' id=''> \
-                    </div> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-10' id=''> \
-                      <input type='checkbox' name='1-10' id=''> \
-                      <input type='checkbox' name='2-10' id=''> \
-                      <input type='checkbox' name='3-10' id=''> \
-                    <input type='checkbox' name='4-10' id=''> \
-                      <input type='checkbox' name='5-10' id=''> \
-                      <input type='checkbox' name='6-10' id=''> \
-                      <input type='checkbox' name='7-10' id=''> \
-                      <input type='checkbox' name='8-10' id=''> \
-                      <input type='checkbox' name='9-10' id=''> \
-                      <input type='checkbox' name='10-10' id=''> \
-                      <input type='checkbox' name='11-10' id=''> \
-                      <input type='checkbox' name='12-10' id=''> \
-                      <input type='checkbox' name='13-10' id=''> \
-                      <input type='checkbox' name='14-10' id=''> \
-                      <input type='checkbox' name='15-10' id=''> \
-                    </div> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-11' id=''> \
-                      <input type='checkbox' name='1-11' id=''> \
-                      <input type='checkbox' name='2-11' id=''> \
-                      <input type='checkbox' name='3-11' id=''> \
-                      <input type='checkbox' name='4-11' id=''> \
-                      <input type='checkbox' name='5-11' id=''> \
-                      <input type='checkbox' name='6-11' id=''> \
-                      <input type='checkbox' name='7-11' id=''> \
-                      <input type='checkbox' name='8-11' id=''> \
-                    <input type='checkbox' name='9-11' id=''> \
-                      <input type='checkbox' name='10-11' id=''> \
-                      <input type='checkbox' name='11-11' id=''> \
-                      <input type='checkbox' name='12-11' id=''> \
-                      <input type='checkbox' name='13-11' id=''> \
-                      <input type='checkbox' name='14-11' id=''> \
-                      <input type='checkbox' name='15-11' id=''> \
-                    </div> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-12' id=''> \
-                      <input type='checkbox' name='1-12' id=''> \
-                      <input type='checkbox' name='2-12' id=''> \
-                      <input type='checkbox' name='3-12' id=''> \
-                      <input type='checkbox' name='4-12' id=''> \
-                      <input type='checkbox' name='5-12' id=''> \
-                      <input type='checkbox' name='6-12' id=''> \
-                    <input type='checkbox' name='7-12' id=''> \
-                      <input type='checkbox' name='8-12' id=''> \
-                      <input type='checkbox' name='9-12' id=''> \
-                      <input type='checkbox' name='10-12' id=''> \
-                      <input type='checkbox' name='11-12' id=''> \
-                      <input type='checkbox' name='12-12' id=''> \
-                      <input type='checkbox' name='13-12' id=''> \
-                      <input type='checkbox' name='14-12' id=''> \
-                      <input type='checkbox' name='15-12' id=''> \
-                    </div> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-13' id=''> \
-                      <input type='checkbox' name='1-13' id=''> \
-                      <input type='checkbox' name='2-13' id=''> \
-                      <input type='checkbox' name='3-13' id=''> \
-                      <input type='checkbox' name='4-13' id=''> \
-                    <input type='checkbox' name='5-13' id=''> \
-                      <input type='checkbox' name='6-13' id=''> \
-                      <input type='checkbox' name='7-13' id=''> \
-                      <input type='checkbox' name='8-13' id=''> \
-                      <input type='checkbox' name='9-13' id=''> \
-                      <input type='checkbox' name='10-13' id=''> \
-                      <input type='checkbox' name='11-13' id=''> \
-                      <input type='checkbox' name='12-13' id=''> \
-                      <input type='checkbox' name='13-13' id=''> \
-                      <input type='checkbox' name='14-13' id=''> \
-                      <input type='checkbox' name='15-13' id=''> \
-                    </div> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-14' id=''> \
-                      <input type='checkbox' name='1-14' id=''> \
-                      <input type='checkbox' name='2-14' id=''> \
-                    <input type='checkbox' name='3-14' id=''> \
-                      <input type='checkbox' name='4-14' id=''> \
-                      <input type='checkbox' name='5-14' id=''> \
-                      <input type='checkbox' name='6-14' id=''> \
-                      <input type='checkbox' name='7-14' id=''> \
-                      <input type='checkbox' name='8-14' id=''> \
-                      <input type='checkbox' name='9-14' id=''> \
-                      <input type='checkbox' name='10-14' id=''> \
-                      <input type='checkbox' name='11-14' id=''> \
-                      <input type='checkbox' name='12-14' id=''> \
-                      <input type='checkbox' name='13-14' id=''> \
-                      <input type='checkbox' name='14-14' id=''> \
-                      <input type='checkbox' name='15-14' id=''> \
-                    </div> \
-                    <div class='row'> \
-                      <input type='checkbox' name='0-15' id=''> \
-                      <input type='checkbox' name='1-15' id=''> \
-                      <input type='checkbox' name='2-15' id=''> \
-                    <input type='checkbox' name='3-15' id=''> \
-                      <input type='checkbox' name='4-15' id=''> \
-                      <input type='checkbox' name='5-15' id=''> \
-                      <input type='checkbox' name='6-15' id=''> \
-                      <input type='checkbox' name='7-15' id=''> \
-                      <input type='checkbox' name='8-15' id=''> \
-                      <input type='checkbox' name='9-15' id=''> \
-                      <input type='checkbox' name='10-15' id=''> \
-                      <input type='checkbox' name='11-15' id=''> \
-                      <input type='checkbox' name='12-15' id=''> \
-                      <input type='checkbox' name='13-15' id=''> \
-                      <input type='checkbox' name='14-15' id=''> \
-                      <input type='checkbox' name='15-15' id=''> \
-                    </div> \
-                  </div> \
-                  <br><br> \
-                  <label for='chooseColor'>Choose a color:</label> \
-                  <select name='textColor' id='chooseColor'> \
-                    <option value='0'>Red</option> \
-                    <option value='1'>Green</option> \
-                    <option value='2'>Blue</option> \
-                    <option value='3'>White</option> \
-                  </select> \
-                  <input type='submit' value='Draw'> \
-              </form> \
-          </body> \
-          </html>";
-}
-
-/**
- * @brief Clear screen, set default position and size of cursor.
+ * @brief Add the shown grid to the undo history if it changed, an empty
+ *        grid when it is not shown
  * 
  */
-void clearScreen() {
-  tft.setCursor(0, 0);
-  tft.fillScreen(ST7735_BLACK);
-  tft.setTextColor(ST7735_WHITE);
-  tft.setTextSize(1);
+void recordHistory() {
+  history.record(grid.isValid() ? grid.codes() : NULL);
 }
 
 /**
- * @brief Print formated text
+ * @brief Paint the current version of the history
  * 
- * @param label 
- * @param text 
  */
-void printText(const char* label, const char *text) {
-  clearScreen();
+void showHistory() {
+  const uint8_t *codes = history.codes();
 
-  tft.println(label);
-  tft.setTextColor(ST7735_GREEN);
-  tft.setTextSize(2);
-  tft.println(text);
+  prepareGrid();
+  for (int i = 0; i < HISTORY_CELLS; i++) {
+    paintCell(i % GridLayout::SIZE, i / GridLayout::SIZE, codes[i]);
+  }
+  queueFlush();
+  broadcastDeltas();
 }
 
+/**
+ * @brief Load the history checkpoint and paint its current version,
+ *        called before WiFi is up
+ * 
+ * @return true when a non-empty grid was restored
+ */
+bool restoreHistory() {
+  prefs.begin("grid", true);
+  size_t size = prefs.getBytes("history", scratch.checkpoint, sizeof(scratch.checkpoint));
+  prefs.end();
+  if (size == 0 || !history.load(scratch.checkpoint, size)) {
+    history.reset(NULL);
+    return false;
+  }
+
+  const uint8_t *codes = history.codes();
+  for (int i = 0; i < HISTORY_CELLS; i++) {
+    if (codes[i] != 0) {
+      showHistory();
+      return true;
+    }
+  }
+  return false;
+}
 
 /**
- * @brief Connect to wifi
+ * @brief Checkpoint the history to flash once it stopped changing.
+ *        Flash is written only when something changed, not more often
+ *        than HISTORY_CHECKPOINT_INTERVAL, and only the used part of the
+ *        delta ring is stored. NVS keeps the previous copy until the new
+ *        one is complete.
  * 
  */
-void connectToWifi() {
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid, password);
+void checkpointHistory() {
+  if (millis() - historyCheckedAt < HISTORY_IDLE_DELAY) {
+    return;
+  }
+  historyCheckedAt = millis();
 
-  while (WiFi.status() != WL_CONNECTED) {
-    tft.print('.');
-    delay(500);
+  bool idle = history.changes() == historySeen;
+  historySeen = history.changes();
+  if (!idle || history.changes() == historySaved ||
+      (historySavedAt != 0 && millis() - historySavedAt < HISTORY_CHECKPOINT_INTERVAL)) {
+    return;
   }
+
+  size_t size = history.save(scratch.checkpoint);
+  prefs.begin("grid", false);
+  prefs.putBytes("history", scratch.checkpoint, size);
+  prefs.end();
+  historySaved = history.changes();
+  historySavedAt = millis();
+  Serial.printf("history: checkpoint of versions %u..%u, %u bytes\n", (unsigned)history.oldest(),
+                (unsigned)history.newest(), (unsigned)size);
 }
 
 /**
- * @brief Load index page
+ * @brief Answer history routes with the current and the kept versions
  * 
+ * @param code 
  */
-void indexPageAction() {
-  server.send(200, "text/html", htmlCode());
+void historyReply(int code) {
+  char json[64];
+
+  snprintf(json, sizeof(json), "{\"version\":%u,\"oldest\":%u,\"newest\":%u}", (unsigned)history.version(),
+           (unsigned)history.oldest(), (unsigned)history.newest());
+  metrics.phase(PHASE_SEND);
+  server.send(code, "application/json", json);
 }
 
 /**
- * @brief Display text and redirect to index page
+ * @brief Go one version back, 409 when there is nothing to undo
  * 
  */
-void displayTextAction() {
-  clearScreen();
+void undoAction() {
+  recordHistory();
+  metrics.phase(PHASE_RENDER);
+  if (!history.undo()) {
+    historyReply(409);
+    return;
+  }
+  showHistory();
+  historyReply(200);
+}
+
+/**
+ * @brief Go one version forward, 409 when there is nothing to redo
+ * 
+ */
+void redoAction() {
+  recordHistory();
+  metrics.phase(PHASE_RENDER);
+  if (!history.redo()) {
+    historyReply(409);
+    return;
+  }
+  showHistory();
+  historyReply(200);
+}
+
+/**
+ * @brief Go to version /snapshot/<n> by replaying the deltas in between,
+ *        404 when the version is no longer kept
+ * 
+ */
+void snapshotAction() {
+  String arg = server.pathArg(0);
+  long version = arg.toInt();
+
+  recordHistory();
+  metrics.phase(PHASE_RENDER);
+  if (arg.length() == 0 || version < 0 || !history.seek(version)) {
+    historyReply(404);
+    return;
+  }
+  showHistory();
+  historyReply(200);
+}
+
+/**
+ * @brief Receive binary body of /draw (any content type except forms)
+ * 
+ */
+void drawBodyAction() {
+  HTTPRaw &raw = server.raw();
+
+  switch (raw.status) {
+  case RAW_START:
+  case RAW_ABORTED:
+    drawBodyLength = 0;
+    break;
+  case RAW_WRITE:
+    if (drawBodyLength < sizeof(scratch.nextCells)) {
+      memcpy(scratch.nextCells + drawBodyLength, raw.buf,
+             min(raw.currentSize, sizeof(scratch.nextCells) - drawBodyLength));
+    }
+    drawBodyLength += raw.currentSize;
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief Draw image and answer 204 with the number of changed cells.
+ *        Only cells that differ from the last drawn image are repainted.
+ * 
+ */
+void drawAction() {
+  bool valid = drawBodyLength > 0 ? parseDrawBody() : parseDrawForm();
+  drawBodyLength = 0;
+  if (!valid) {
+    server.send(400, "text/plain", "Invalid bitmap size or colour");
+    return;
+  }
+
+  metrics.phase(PHASE_RENDER);
+  int changed = commitCells();
 
-  tft.setTextSize(2);
-  tft.println(server.arg("text"));
+  metrics.phase(PHASE_SEND);
+  server.sendHeader("X-Cells-Changed", String(changed));
+  server.sendHeader("X-Render-Backlog", String(renderBacklog()));
+  server.send(204);
+}
 
-  server.sendHeader("Location", "/", true);  
-  server.send(302, "text/plain", "");
+/**
+ * @brief Queue pixels collected for the current span
+ * 
+ */
+void queuePendingSpan() {
+  if (pendingSpan.length > 0) {
+    queueCommand(pendingSpan);
+    pendingSpan.length = 0;
+  }
 }
 
 /**
- * @brief Draw pixel 8x8
+ * @brief Decoded pixel of an uploaded image. Pixels are sent to the render
+ *        task in spans; every LCD_DMA_LINES rows are flushed to the panel.
  * 
  * @param x 
  * @param y 
  * @param color 
+ * @param ctx 
+ */
+void imagePixel(uint16_t x, uint16_t y, uint16_t color, void *ctx) {
+  if (pendingSpan.length == 0) {
+    pendingSpan.x = x;
+    pendingSpan.y = y;
+  }
+  pendingSpan.data[pendingSpan.length++] = color & 0xFF;
+  pendingSpan.data[pendingSpan.length++] = color >> 8;
+
+  bool rowEnd = x == imageDecoder.width() - 1;
+  if (pendingSpan.length == DRAW_SPAN_PIXELS * 2 || rowEnd) {
+    queuePendingSpan();
+  }
+  if (rowEnd && (y + 1) % LCD_DMA_LINES == 0) {
+    queueFlush();
+  }
+}
+
+/**
+ * @brief Receive body of /image and decode it as it arrives. Query
+ *        arguments: format=rgb565|rle|qoi, width and height for raw
+ *        formats (full screen by default).
+ * 
  */
-void drawPixel(int x, int y, int color) {
-  x *= 8;
-  y *= 8;
-  for (int i = 0; i < 8; i++) {
-    for (int j = 0; j < 8; j++) {
-      tft.drawPixel(x + i, y + j, color);
+void imageBodyAction() {
+  HTTPRaw &raw = server.raw();
+
+  switch (raw.status) {
+  case RAW_START: {
+    ImageFormat format = IMAGE_RGB565;
+    if (server.arg("format") == "rle") {
+      format = IMAGE_RLE;
+    } else if (server.arg("format") == "qoi") {
+      format = IMAGE_QOI;
+    }
+
+    long width = server.hasArg("width") ? server.arg("width").toInt() : CANVAS_WIDTH;
+    long height = server.hasArg("height") ? server.arg("height").toInt() : CANVAS_HEIGHT;
+    if (format == IMAGE_QOI || width < 1 || width > CANVAS_WIDTH || height < 1 || height > CANVAS_HEIGHT) {
+      width = CANVAS_WIDTH;
+      height = CANVAS_HEIGHT;
     }
+
+    imageReceived = true;
+    imageBytes = 0;
+    imageStart = millis();
+    pendingSpan.length = 0;
+    queueClear();
+    imageDecoder.begin(format, width, height, imagePixel, NULL);
+    break;
+  }
+  case RAW_WRITE:
+    imageBytes += raw.currentSize;
+    imageDecoder.feed(raw.buf, raw.currentSize);
+    break;
+  case RAW_END:
+  case RAW_ABORTED:
+    queuePendingSpan();
+    queueFlush();
+    recordHistory();
+    break;
+  default:
+    break;
   }
 }
 
 /**
- * @brief Draw image and redirect to index page
+ * @brief Finish image upload, report size and upload and decode
+ *        throughput. Returns as soon as the rows are queued; the render
+ *        task puts them on the panel while the server goes on serving.
  * 
  */
-void drawAction() {
-  clearScreen();
-  
-  char name[10];
-  int color = ST7735_WHITE;
+void imageAction() {
+  if (!imageReceived || imageDecoder.hasFailed()) {
+    imageReceived = false;
+    server.send(400, "text/plain", "Invalid image data");
+    return;
+  }
+  imageReceived = false;
 
-  if (server.hasArg("textColor")) {
-    switch (server.arg("textColor").toInt())
-    {
-    case 0:
-      color = ST7735_RED;
+  unsigned long elapsed = max(millis() - imageStart, 1UL);
+
+  char json[96];
+  snprintf(json, sizeof(json), "{\"pixels\":%u,\"bytes\":%u,\"ms\":%lu,\"kpixels_per_s\":%lu}",
+           (unsigned)imageDecoder.pixels(), (unsigned)imageBytes, elapsed,
+           (unsigned long)imageDecoder.pixels() / elapsed);
+
+  metrics.phase(PHASE_SEND);
+  server.send(imageDecoder.isComplete() ? 200 : 400, "application/json", json);
+}
+
+/**
+ * @brief Receive frames posted to /animation, each one byte per cell like
+ *        the /draw cell body, and store them as deltas as they arrive
+ * 
+ */
+void animationBodyAction() {
+  HTTPRaw &raw = server.raw();
+
+  switch (raw.status) {
+  case RAW_START:
+    stopAnimation();
+    animation.begin(PALETTE_SIZE, scratch.animationFrame);
+    animationUploaded = true;
+    break;
+  case RAW_WRITE:
+    animation.feed(raw.buf, raw.currentSize);
+    break;
+  case RAW_ABORTED:
+    animationUploaded = false;
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief Start playing the uploaded frames. Query arguments: fps (1 to
+ *        ANIMATION_MAX_FPS, default ANIMATION_DEFAULT_FPS) and loop=0 to
+ *        stop on the last frame.
+ * 
+ */
+void animationAction() {
+  bool uploaded = animationUploaded;
+  animationUploaded = false;
+  if (!uploaded) {
+    server.send(400, "text/plain", "Frames must be the raw request body\n");
+    return;
+  }
+  if (!animation.end()) {
+    server.send(animation.isFull() ? 413 : 400, "text/plain",
+                animation.isFull() ? "Animation too large\n" : "Invalid frames\n");
+    return;
+  }
+
+  long fps = server.hasArg("fps") ? server.arg("fps").toInt() : ANIMATION_DEFAULT_FPS;
+  if (fps < 1 || fps > ANIMATION_MAX_FPS) {
+    fps = fps < 1 ? 1 : ANIMATION_MAX_FPS;
+  }
+
+  metrics.phase(PHASE_RENDER);
+  queueClear();
+  queueFlush();
+  animationPeriodMs = 1000 / fps;
+  animationLoop = server.arg("loop") != "0";
+  animationNext = 0;
+  animationPlaying.store(true);
+  framesDue.store(1);
+  xTaskNotifyGive(renderTaskHandle);
+  xTaskNotifyGive(playerTaskHandle);
+
+  char json[96];
+  snprintf(json, sizeof(json), "{\"frames\":%u,\"bytes\":%u,\"full_bytes\":%u,\"fps\":%ld}",
+           (unsigned)animation.frameCount(), (unsigned)animation.bytesUsed(),
+           (unsigned)(animation.frameCount() * GridLayout::CELLS), fps);
+  metrics.phase(PHASE_SEND);
+  server.send(200, "application/json", json);
+}
+
+/**
+ * @brief Playback state of the animation
+ * 
+ */
+void animationStatusAction() {
+  char json[96];
+
+  snprintf(json, sizeof(json), "{\"playing\":%s,\"frames\":%u,\"shown\":%u,\"dropped\":%u}",
+           animationPlaying.load() ? "true" : "false", (unsigned)animation.frameCount(),
+           (unsigned)framesShown.load(std::memory_order_relaxed),
+           (unsigned)framesDropped.load(std::memory_order_relaxed));
+  server.send(200, "application/json", json);
+}
+
+/**
+ * @brief Little endian 16 bit value of the display list
+ * 
+ * @param p 
+ * @return uint16_t 
+ */
+uint16_t readLe16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+/**
+ * @brief Size of the display list op at the given position
+ * 
+ * @param op 
+ * @param left bytes from op to the end of the list
+ * @return size_t 0 when the op is unknown or truncated
+ */
+size_t displayOpSize(const uint8_t *op, size_t left) {
+  size_t size;
+
+  switch (op[0]) {
+  case OP_CLEAR:
+    size = 1;
+    break;
+  case OP_FILL_RECT:
+  case OP_RECT:
+  case OP_LINE:
+    size = 11;
+    break;
+  case OP_CIRCLE:
+  case OP_FILL_CIRCLE:
+    size = 9;
+    break;
+  case OP_TEXT:
+    size = 9;
+    if (left >= size) {
+      size += op[8];
+    }
+    break;
+  case OP_BLIT:
+    size = 9;
+    if (left >= size) {
+      int16_t w = readLe16(op + 5), h = readLe16(op + 7);
+      if (w < 0 || h < 0) {
+        return 0;
+      }
+      size += (size_t)w * h * 2;
+    }
+    break;
+  case OP_PALETTE:
+    size = 4;
+    break;
+  default:
+    return 0;
+  }
+  return size <= left ? size : 0;
+}
+
+/**
+ * @brief Queue rectangle, line or circle. The grid is no longer shown
+ *        afterwards.
+ * 
+ * @param op 
+ * @param x 
+ * @param y 
+ * @param p0 width, end x or radius
+ * @param p1 height or end y
+ * @param color 
+ */
+void queueShape(uint8_t op, int16_t x, int16_t y, int16_t p0, int16_t p1, uint16_t color) {
+  DrawCommand cmd = {CMD_SHAPE, 4, 0, op, color, x, y, {0}};
+  int16_t p[2] = {p0, p1};
+
+  memcpy(cmd.data, p, sizeof(p));
+  queuePendingCells();
+  grid.invalidate();
+  queueCommand(cmd);
+}
+
+/**
+ * @brief Queue text printed from x, y
+ * 
+ * @param x 
+ * @param y 
+ * @param text not terminated
+ * @param length 
+ * @param size 
+ * @param color 
+ */
+void queueTextAt(int16_t x, int16_t y, const uint8_t *text, size_t length, uint8_t size, uint16_t color) {
+  DrawCommand cmd = {CMD_TEXT, 0, size, DRAW_AT, color, x, y, {0}};
+
+  queuePendingCells();
+  grid.invalidate();
+  while (length > 0) {
+    cmd.length = min(length, (size_t)DRAW_PAYLOAD);
+    memcpy(cmd.data, text, cmd.length);
+    text += cmd.length;
+    length -= cmd.length;
+    queueCommand(cmd);
+    cmd.flags = 0;
+  }
+}
+
+/**
+ * @brief Queue block of little endian RGB565 pixels as row spans
+ * 
+ * @param x 
+ * @param y 
+ * @param w 
+ * @param h 
+ * @param pixels 
+ */
+void queueBlit(int16_t x, int16_t y, int16_t w, int16_t h, const uint8_t *pixels) {
+  DrawCommand cmd = {CMD_SPAN, 0, 0, 0, 0, 0, 0, {0}};
+
+  queuePendingCells();
+  grid.invalidate();
+  for (int16_t row = 0; row < h; row++) {
+    for (int16_t i = 0; i < w; i += DRAW_SPAN_PIXELS) {
+      cmd.x = x + i;
+      cmd.y = y + row;
+      cmd.length = min(w - i, DRAW_SPAN_PIXELS) * 2;
+      memcpy(cmd.data, pixels, cmd.length);
+      pixels += cmd.length;
+      queueCommand(cmd);
+    }
+  }
+}
+
+/**
+ * @brief Change palette entry. The canvas recolours every pixel drawn with
+ *        the entry at flush, no cell is repainted. The grid keeps codes, so
+ *        it stays right as it is.
+ * 
+ * @param index 
+ * @param color 
+ */
+void setPaletteColor(uint8_t index, uint16_t color) {
+  DrawCommand cmd = {CMD_PALETTE, 0, 0, (uint8_t)(index + 1), color, 0, 0, {0}};
+  palette[index] = color;
+  queuePendingCells();
+  queueCommand(cmd);
+}
+
+/**
+ * @brief Walk the display list, queueing its primitives when execute is set
+ * 
+ * @param list 
+ * @param length 
+ * @param execute 
+ * @return int number of primitives, -1 when the list is malformed
+ */
+int runDisplayList(const uint8_t *list, size_t length, bool execute) {
+  int count = 0;
+
+  for (size_t pos = 0; pos < length; count++) {
+    const uint8_t *op = &list[pos];
+    size_t size = displayOpSize(op, length - pos);
+    if (size == 0 || (op[0] == OP_PALETTE && op[1] >= PALETTE_SIZE)) {
+      return -1;
+    }
+    pos += size;
+    if (!execute) {
+      continue;
+    }
+
+    int16_t x = readLe16(op + 1), y = readLe16(op + 3);
+    switch (op[0]) {
+    case OP_CLEAR:
+      queueClear();
+      break;
+    case OP_FILL_RECT:
+    case OP_RECT:
+    case OP_LINE:
+      queueShape(op[0], x, y, readLe16(op + 5), readLe16(op + 7), readLe16(op + 9));
       break;
-    case 1:
-      color = ST7735_GREEN;
+    case OP_CIRCLE:
+    case OP_FILL_CIRCLE:
+      queueShape(op[0], x, y, readLe16(op + 5), 0, readLe16(op + 7));
       break;
-    case 2:
-      color = ST7735_BLUE;
+    case OP_TEXT:
+      queueTextAt(x, y, op + 9, op[8], op[7], readLe16(op + 5));
       break;
-    case 3:
-      color = ST7735_WHITE;
+    case OP_BLIT:
+      queueBlit(x, y, readLe16(op + 5), readLe16(op + 7), op + 9);
+      break;
+    case OP_PALETTE:
+      setPaletteColor(op[1], readLe16(op + 2));
       break;
     default:
       break;
     }
   }
+  return count;
+}
+
+/**
+ * @brief Receive display list of /cmd
+ * 
+ */
+void cmdBodyAction() {
+  HTTPRaw &raw = server.raw();
+
+  switch (raw.status) {
+  case RAW_START:
+  case RAW_ABORTED:
+    cmdBodyLength = 0;
+    break;
+  case RAW_WRITE:
+    if (cmdBodyLength < sizeof(cmdBody)) {
+      memcpy(cmdBody + cmdBodyLength, raw.buf, min(raw.currentSize, sizeof(cmdBody) - cmdBodyLength));
+    }
+    cmdBodyLength += raw.currentSize;
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief Execute a display list as one batch: the whole list is validated
+ *        first, then queued and flushed once, so overlapping primitives end
+ *        up in the same merged dirty regions of the canvas.
+ * 
+ */
+void cmdAction() {
+  size_t length = cmdBodyLength;
+  cmdBodyLength = 0;
+
+  if (length > sizeof(cmdBody)) {
+    server.send(413, "text/plain", "Display list too long");
+    return;
+  }
+
+  int count = runDisplayList(cmdBody, length, false);
+  if (count <= 0) {
+    server.send(400, "text/plain", "Invalid display list");
+    return;
+  }
+
+  metrics.phase(PHASE_RENDER);
+  runDisplayList(cmdBody, length, true);
+  queueFlush();
+  broadcastDeltas();
+  recordHistory();
+
+  metrics.phase(PHASE_SEND);
+  server.sendHeader("X-Primitives", String(count));
+  server.sendHeader("X-Render-Backlog", String(renderBacklog()));
+  server.send(204);
+}
+
+/**
+ * @brief Print that sends its output as chunks of the current response
+ *        through a fixed buffer
+ * 
+ */
+class ResponsePrint : public Print {
+public:
+  ResponsePrint() : length(0) {}
+
+  size_t write(uint8_t c) override {
+    buffer[length++] = c;
+    if (length == sizeof(buffer)) {
+      send();
+    }
+    return 1;
+  }
 
-  for (int y = 0; y < 16; y++) {
-    for (int x = 0; x < 16; x++) {
-      sprintf(name, "%d-%d", y, x);      
-      
-      if (server.hasArg(name)) {
-          drawPixel(x, y, color);
+  void send() {
+    if (length > 0) {
+      server.sendContent(buffer, length);
+      length = 0;
+    }
+  }
+
+private:
+  char buffer[1024];
+  size_t length;
+};
+
+ResponsePrint responseOut;
+
+/**
+ * @brief Current screen as RLE runs (count - 1, colour low, colour high),
+ *        the whole canvas or the region given by x, y, w and h. Read from
+ *        the canvas and streamed through the response buffer.
+ * 
+ */
+void screenAction() {
+  long x = server.hasArg("x") ? server.arg("x").toInt() : 0;
+  long y = server.hasArg("y") ? server.arg("y").toInt() : 0;
+  long w = server.hasArg("w") ? server.arg("w").toInt() : canvas.width();
+  long h = server.hasArg("h") ? server.arg("h").toInt() : canvas.height();
+
+  if (x < 0 || y < 0 || w < 1 || h < 1 || x + w > canvas.width() || y + h > canvas.height()) {
+    server.send(400, "text/plain", "Region outside the screen\n");
+    return;
+  }
+
+  metrics.phase(PHASE_SEND);
+  server.sendHeader("Cache-Control", "no-store");
+  server.sendHeader("X-Width", String(w));
+  server.sendHeader("X-Height", String(h));
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/octet-stream", "");
+  screen.writeRle(responseOut, x, y, w, h);
+  responseOut.send();
+  server.sendContent("");
+}
+
+/**
+ * @brief Keep the connection open as a server-sent events stream of the
+ *        regions that change on the screen
+ * 
+ */
+void screenEventsAction() {
+  if (!screen.addViewer(server.client())) {
+    server.send(503, "text/plain", "Too many viewers\n");
+    return;
+  }
+  // The viewer's copy keeps the socket open; without this the server
+  // waits for the browser to close it before taking the next client
+  server.client().stop();
+}
+
+/**
+ * @brief Export request timings, display and heap counters in Prometheus
+ *        text format. Values written by the render task are read without
+ *        locking, a scrape may see them one batch behind.
+ * 
+ */
+void metricsAction() {
+  metrics.phase(PHASE_SEND);
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/plain; version=0.0.4", "");
+
+  metrics.print(responseOut);
+  responseOut.print("# HELP tft_render_batch_seconds Render task time per wake-up\n"
+                   "# TYPE tft_render_batch_seconds histogram\n");
+  Metrics::printHistogram(responseOut, "tft_render_batch_seconds", "", renderBatch);
+  Metrics::printValue(responseOut, "tft_spi_bytes_total", "counter", "Bytes written to the display",
+                      canvas.bytesFlushed());
+  Metrics::printValue(responseOut, "tft_display_windows_total", "counter", "Address windows written to the display",
+                      canvas.windowsFlushed());
+  Metrics::printValue(responseOut, "tft_panel_switches_total", "counter", "Chip select changes between panels",
+                      panels.panelSwitches());
+  Metrics::printValue(responseOut, "tft_animation_frames_shown_total", "counter", "Animation frames sent to the panels",
+                      framesShown.load(std::memory_order_relaxed));
+  Metrics::printValue(responseOut, "tft_animation_frames_dropped_total", "counter",
+                      "Animation frames skipped because the render task was late",
+                      framesDropped.load(std::memory_order_relaxed));
+  Metrics::printValue(responseOut, "tft_screen_viewers", "gauge", "Open /screen/events streams",
+                      screen.viewerCount());
+  Metrics::printValue(responseOut, "tft_screen_events_total", "counter", "Changed region events sent to viewers",
+                      screen.eventsSent());
+  Metrics::printValue(responseOut, "tft_render_commands_total", "counter", "Draw commands executed",
+                      commandsRendered.load(std::memory_order_acquire));
+  Metrics::printValue(responseOut, "tft_updates_rendered_total", "counter", "Updates that ended with a flush",
+                      updatesRendered.load(std::memory_order_relaxed));
+  Metrics::printValue(responseOut, "tft_updates_coalesced_total", "counter",
+                      "Updates merged into a later flush, never sent on their own",
+                      updatesCoalesced.load(std::memory_order_relaxed));
+  Metrics::printValue(responseOut, "tft_glyph_cache_hits_total", "counter", "Characters drawn from the glyph cache",
+                      textRenderer.cacheHits());
+  Metrics::printValue(responseOut, "tft_glyph_cache_misses_total", "counter", "Glyphs rasterized into the cache",
+                      textRenderer.cacheMisses());
+  Metrics::printValue(responseOut, "tft_render_commands_queued_total", "counter", "Draw commands queued by loop()",
+                      commandsQueued);
+  Metrics::printValue(responseOut, "tft_render_queue_depth", "gauge", "Commands waiting in the render queue",
+                      renderQueue.size());
+  Metrics::printValue(responseOut, "tft_render_queue_capacity", "gauge", "Size of the render queue",
+                      renderQueue.capacity());
+  Metrics::printValue(responseOut, "tft_render_queue_stalls_total", "counter", "Waits for space in the render queue",
+                      queueStalls);
+  Metrics::printValue(responseOut, "tft_render_queue_high_water", "gauge", "Most commands waiting in the queue",
+                      queueHighWater);
+  Metrics::printValue(responseOut, "tft_heap_free_bytes", "gauge", "Free heap", ESP.getFreeHeap());
+  Metrics::printValue(responseOut, "tft_heap_min_free_bytes", "gauge", "Free heap low-water mark",
+                      ESP.getMinFreeHeap());
+  responseOut.send();
+  server.sendContent("");
+}
+
+/**
+ * @brief Report boot to first served request time once
+ * 
+ */
+void reportFirstRequest() {
+  if (!firstRequestServed) {
+    firstRequestServed = true;
+    Serial.printf("boot: first request served %lu ms after boot (server up at %lu ms)\n", millis(), serverReadyAt);
+  }
+}
+
+/**
+ * @brief Register route whose handler is timed by metrics
+ * 
+ * @param uri 
+ * @param method 
+ * @param handler 
+ */
+void onTimed(const char *uri, HTTPMethod method, void (*handler)()) {
+  int route = metrics.addRoute(uri);
+  auto timed = [route, handler]() {
+    metrics.begin(route);
+    handler();
+    metrics.end();
+    reportFirstRequest();
+  };
+
+  if (strstr(uri, "{}")) {
+    server.on(UriBraces(uri), method, timed);
+  } else {
+    server.on(uri, method, timed);
+  }
+}
+
+/**
+ * @brief Register route with a body receiver, timing starts with the body
+ * 
+ * @param uri 
+ * @param method 
+ * @param handler 
+ * @param bodyHandler 
+ */
+void onTimed(const char *uri, HTTPMethod method, void (*handler)(), void (*bodyHandler)()) {
+  int route = metrics.addRoute(uri);
+
+  server.on(uri, method, [route, handler]() {
+    metrics.begin(route);
+    handler();
+    metrics.end();
+    reportFirstRequest();
+  }, [route, bodyHandler]() {
+    metrics.begin(route);
+    bodyHandler();
+  });
+}
+
+/**
+ * @brief Live drawing channel. Clients send binary frames of 3 byte cell
+ *        changes (x, y, colour code), which are painted right away and
+ *        broadcast to every client. A new client gets the current grid.
+ * 
+ * @param num 
+ * @param type 
+ * @param payload 
+ * @param length 
+ */
+void webSocketEvent(uint8_t num, WStype_t type, uint8_t *payload, size_t length) {
+  if (type == WStype_CONNECTED && grid.isValid()) {
+    size_t n = 0;
+    for (int y = 0; y < GridLayout::SIZE; y++) {
+      for (int x = 0; x < GridLayout::SIZE; x++) {
+        if (grid.get(x, y) != 0) {
+          deltas[n++] = x;
+          deltas[n++] = y;
+          deltas[n++] = grid.get(x, y);
+        }
+        if (n == sizeof(deltas)) {
+          webSocket.sendBIN(num, deltas, n);
+          n = 0;
+        }
       }
     }
+    if (n > 0) {
+      webSocket.sendBIN(num, deltas, n);
+    }
+    return;
   }
 
-  server.sendHeader("Location", "/", true);  
-  server.send(302, "text/plain", "");
+  if (type != WStype_BIN || length % DELTA_SIZE != 0 || length > GridLayout::CELLS * DELTA_SIZE) {
+    return;
+  }
+
+  prepareGrid();
+  for (size_t i = 0; i < length; i += DELTA_SIZE) {
+    if (payload[i] < GridLayout::SIZE && payload[i + 1] < GridLayout::SIZE && payload[i + 2] <= PALETTE_SIZE) {
+      paintCell(payload[i], payload[i + 1], payload[i + 2]);
+    }
+  }
+  queueFlush();
+  broadcastDeltas();
+  recordHistory();
 }
 
 /**
@@ -508,26 +1819,76 @@ void drawAction() {
  * 
  */
 void setUpRoutings() {
-  server.on("/", indexPageAction);
-  server.on("/text", HTTP_POST, displayTextAction);
-  server.on("/draw", HTTP_POST, drawAction);
+  const char *headerKeys[] = {"If-None-Match"};
+  server.collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
+
+  onTimed("/", HTTP_ANY, indexPageAction);
+  onTimed("/text", HTTP_POST, displayTextAction);
+  onTimed("/draw", HTTP_POST, drawAction, drawBodyAction);
+  onTimed("/image", HTTP_POST, imageAction, imageBodyAction);
+  onTimed("/cmd", HTTP_POST, cmdAction, cmdBodyAction);
+  onTimed("/undo", HTTP_POST, undoAction);
+  onTimed("/redo", HTTP_POST, redoAction);
+  onTimed("/snapshot/{}", HTTP_POST, snapshotAction);
+  onTimed("/metrics", HTTP_GET, metricsAction);
+  onTimed("/animation", HTTP_POST, animationAction, animationBodyAction);
+  onTimed("/animation/status", HTTP_GET, animationStatusAction);
+  onTimed("/screen", HTTP_GET, screenAction);
+  onTimed("/screen/events", HTTP_GET, screenEventsAction);
+}
+
+/**
+ * @brief Give the canvas fixed entries for black and the cell palette,
+ *        called before the render task starts
+ * 
+ */
+void setUpPalette() {
+  canvas.setPaletteColor(0, ST7735_BLACK);
+  for (int i = 0; i < PALETTE_SIZE; i++) {
+    canvas.setPaletteColor(i + 1, palette[i]);
+  }
+  canvas.reservePalette(PALETTE_SIZE + 1);
+  canvas.reserveColorCube();
 }
 
 void setup(void) {
   Serial.begin(115200);
-  tft.initR(INITR_144GREENTAB); // Init ST7735R chip, green tab
-  
-  printText("Connecting to", ssid);
+  tft.initR(INITR_144GREENTAB); // Init ST7735R chip, green tab; resets all panels
+  tft.setSPISpeed(TFT_SPI_FREQ);
+  panels.setPanel(0, 0, &tft, TFT_CS);
+  for (int i = 1; i < PANEL_COUNT; i++) {
+    Adafruit_ST7735 *panel = new Adafruit_ST7735(panelCs[i], TFT_DC, -1);
+    panel->initR(INITR_144GREENTAB);
+    panel->setSPISpeed(TFT_SPI_FREQ);
+    panels.setPanel(i % PANEL_COLS, i / PANEL_COLS, panel, panelCs[i]);
+  }
+  if (!lcd.begin(TFT_SPI_FREQ, TFT_WIDTH)) {
+    Serial.println("DMA not available, using blocking SPI");
+  }
+  panels.setDma(&lcd);
+  setUpPalette();
+  xTaskCreatePinnedToCore(renderTask, "render", 4096, NULL, 1, &renderTaskHandle, RENDER_CORE);
+  xTaskCreatePinnedToCore(playerTask, "player", 2048, NULL, PLAYER_PRIORITY, &playerTaskHandle, RENDER_CORE);
+
+  if (!restoreHistory()) {
+    printText("Connecting to", ssid);
+    bootScreenShown = true;
+  }
   connectToWifi();
 
-  char buf[16];
-  WiFi.localIP().toString().toCharArray(buf, sizeof(buf));
-  printText("Connected!", (const char *)buf);
-  
   setUpRoutings();
   server.begin();
+
+  webSocket.begin();
+  webSocket.onEvent(webSocketEvent);
+  serverReadyAt = millis();
+  Serial.printf("boot: server up %lu ms after boot\n", serverReadyAt);
 }
 
 void loop() {
+  checkWifi();
   server.handleClient();
+  webSocket.loop();
+  screen.poll();
+  checkpointHistory();
 }
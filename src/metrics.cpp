@@ -0,0 +1,152 @@
+/**
+ * @file metrics.cpp
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Request timing histograms exported in Prometheus text format
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#include <string.h>
+#include "metrics.h"
+
+static const uint32_t bucketBounds[METRICS_BUCKETS] = METRICS_BUCKET_BOUNDS;
+static const char *phaseNames[PHASE_COUNT] = {"parse", "render", "send"};
+
+/**
+ * @brief Count one measurement
+ * 
+ * @param cycles 
+ */
+void Histogram::add(uint32_t cycles) {
+  uint32_t us = cycles / ESP.getCpuFreqMHz();
+  uint8_t i = 0;
+
+  while (i < METRICS_BUCKETS && us > bucketBounds[i]) {
+    i++;
+  }
+  buckets[i]++;
+  count++;
+  sumCycles += cycles;
+}
+
+/**
+ * @brief Register route, call once per route from setup
+ * 
+ * @param uri 
+ * @return int route index, -1 when the table is full
+ */
+int Metrics::addRoute(const char *uri) {
+  if (routeCount == METRICS_MAX_ROUTES) {
+    return -1;
+  }
+
+  Route &r = routes[routeCount];
+  memset(&r, 0, sizeof(r));
+  r.uri = uri;
+  return routeCount++;
+}
+
+/**
+ * @brief Start timing a request in the parse phase. Repeated calls for the
+ *        request in progress (body receiver, then handler) are ignored.
+ * 
+ * @param route 
+ */
+void Metrics::begin(int route) {
+  if (route < 0 || route >= routeCount || (active && this->route == route)) {
+    return;
+  }
+
+  active = true;
+  this->route = route;
+  current = PHASE_PARSE;
+  phaseStart = ESP.getCycleCount();
+}
+
+/**
+ * @brief Close the current phase and start the next one
+ * 
+ * @param next 
+ */
+void Metrics::phase(MetricsPhase next) {
+  if (!active) {
+    return;
+  }
+
+  uint32_t now = ESP.getCycleCount();
+  routes[route].phases[current].add(now - phaseStart);
+  current = next;
+  phaseStart = now;
+}
+
+/**
+ * @brief Close the last phase and count the request
+ * 
+ */
+void Metrics::end() {
+  if (!active) {
+    return;
+  }
+
+  phase(current);
+  routes[route].requests++;
+  active = false;
+}
+
+/**
+ * @brief Print histogram as Prometheus buckets, sum and count
+ * 
+ * @param out 
+ * @param name 
+ * @param labels label list without braces, may be empty
+ * @param histogram 
+ */
+void Metrics::printHistogram(Print &out, const char *name, const char *labels, const Histogram &histogram) {
+  const char *sep = labels[0] ? "," : "";
+  uint32_t cumulative = 0;
+
+  for (uint8_t i = 0; i < METRICS_BUCKETS; i++) {
+    cumulative += histogram.buckets[i];
+    out.printf("%s_bucket{%s%sle=\"%g\"} %u\n", name, labels, sep, bucketBounds[i] / 1e6, (unsigned)cumulative);
+  }
+  out.printf("%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, sep, (unsigned)histogram.count);
+  out.printf("%s_sum{%s} %.6f\n", name, labels, histogram.sumCycles / (ESP.getCpuFreqMHz() * 1e6));
+  out.printf("%s_count{%s} %u\n", name, labels, (unsigned)histogram.count);
+}
+
+/**
+ * @brief Print single value metric with its HELP and TYPE lines
+ * 
+ * @param out 
+ * @param name 
+ * @param type counter or gauge
+ * @param help 
+ * @param value 
+ */
+void Metrics::printValue(Print &out, const char *name, const char *type, const char *help, double value) {
+  out.printf("# HELP %s %s\n# TYPE %s %s\n%s %.0f\n", name, help, name, type, name, value);
+}
+
+/**
+ * @brief Print request counts and phase histograms of all routes
+ * 
+ * @param out 
+ */
+void Metrics::print(Print &out) const {
+  char labels[64];
+
+  out.print("# HELP tft_requests_total Handled requests per route\n# TYPE tft_requests_total counter\n");
+  for (uint8_t i = 0; i < routeCount; i++) {
+    out.printf("tft_requests_total{route=\"%s\"} %u\n", routes[i].uri, (unsigned)routes[i].requests);
+  }
+
+  out.print("# HELP tft_request_phase_seconds Handler time per route and phase\n"
+            "# TYPE tft_request_phase_seconds histogram\n");
+  for (uint8_t i = 0; i < routeCount; i++) {
+    for (uint8_t p = 0; p < PHASE_COUNT; p++) {
+      snprintf(labels, sizeof(labels), "route=\"%s\",phase=\"%s\"", routes[i].uri, phaseNames[p]);
+      printHistogram(out, "tft_request_phase_seconds", labels, routes[i].phases[p]);
+    }
+  }
+}
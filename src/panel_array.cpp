@@ -0,0 +1,122 @@
+/**
+ * @file panel_array.cpp
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Canvas tiled across several panels that share one SPI bus
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#include <string.h>
+#include "panel_array.h"
+
+PanelArray::PanelArray(uint8_t cols, uint8_t rows, int16_t width, int16_t height)
+    : cols(cols), rows(rows), width(width), height(height), lcd(NULL), current(-1), switches(0) {
+  memset(panels, 0, sizeof(panels));
+}
+
+/**
+ * @brief Attach the panel showing tile (col, row)
+ * 
+ * @param col 
+ * @param row 
+ * @param display driver of the panel, used for blocking writes
+ * @param cs chip select pin, used with select() of the DMA path
+ */
+void PanelArray::setPanel(uint8_t col, uint8_t row, Adafruit_SPITFT *display, int8_t cs) {
+  if (col >= cols || row >= rows || row * cols + col >= PANEL_MAX) {
+    return;
+  }
+
+  panels[row * cols + col].display = display;
+  panels[row * cols + col].cs = cs;
+}
+
+/**
+ * @brief Make panel i the addressed one, counting chip select changes
+ * 
+ * @param i 
+ */
+void PanelArray::select(uint8_t i) {
+  if (i != current) {
+    switches++;
+    current = i;
+  }
+  if (useDma()) {
+    lcd->select(panels[i].cs);
+  }
+}
+
+/**
+ * @brief Send the dirty regions of the canvas, panel by panel. Regions are
+ *        clipped to each tile and written at their position on that panel.
+ * 
+ * @param canvas 
+ */
+void PanelArray::flush(Canvas &canvas) {
+  uint8_t n = count();
+  uint8_t first = current < 0 ? 0 : current;
+
+  for (uint8_t k = 0; k < n; k++) {
+    uint8_t i = (first + k) % n;
+    int16_t left = i % cols * width;
+    int16_t top = i / cols * height;
+    DirtyRect tile[CANVAS_MAX_DIRTY];
+    uint8_t found = 0;
+
+    for (uint8_t j = 0; j < canvas.regionCount(); j++) {
+      const DirtyRect &r = canvas.region(j);
+      int16_t x1 = max(r.x, left);
+      int16_t y1 = max(r.y, top);
+      int16_t x2 = min((int16_t)(r.x + r.w), (int16_t)(left + width));
+      int16_t y2 = min((int16_t)(r.y + r.h), (int16_t)(top + height));
+      if (x1 < x2 && y1 < y2) {
+        tile[found++] = {x1, y1, (int16_t)(x2 - x1), (int16_t)(y2 - y1)};
+      }
+    }
+    if (found == 0 || !panels[i].display) {
+      continue;
+    }
+
+    select(i);
+    if (useDma()) {
+      for (uint8_t j = 0; j < found; j++) {
+        canvas.writeRegion(*lcd, tile[j], tile[j].x - left, tile[j].y - top);
+      }
+    } else {
+      Adafruit_SPITFT &display = *panels[i].display;
+      display.startWrite();
+      for (uint8_t j = 0; j < found; j++) {
+        canvas.writeRegion(display, tile[j], tile[j].x - left, tile[j].y - top);
+      }
+      display.endWrite();
+    }
+  }
+  canvas.clearDirty();
+}
+
+/**
+ * @brief Send the same command to every panel, after the queued pixels
+ * 
+ * @param cmd 
+ * @param data 
+ * @param length 
+ */
+void PanelArray::sendCommand(uint8_t cmd, const uint8_t *data, uint8_t length) {
+  uint8_t n = count();
+  uint8_t first = current < 0 ? 0 : current;
+
+  for (uint8_t k = 0; k < n; k++) {
+    uint8_t i = (first + k) % n;
+    if (!panels[i].display) {
+      continue;
+    }
+
+    select(i);
+    if (useDma()) {
+      lcd->sendCommand(cmd, data, length);
+    } else {
+      panels[i].display->sendCommand(cmd, data, length);
+    }
+  }
+}
@@ -0,0 +1,210 @@
+/**
+ * @file screen_mirror.cpp
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Canvas contents for browsers: RLE snapshots and a server-sent
+ *        events stream of changed regions
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#include "screen_mirror.h"
+
+/**
+ * @brief Bounding box of two rectangles
+ * 
+ * @param a 
+ * @param b 
+ * @return DirtyRect 
+ */
+static DirtyRect bounds(const DirtyRect &a, const DirtyRect &b) {
+  int16_t x = min(a.x, b.x);
+  int16_t y = min(a.y, b.y);
+  DirtyRect r = {x, y, (int16_t)(max(a.x + a.w, b.x + b.w) - x), (int16_t)(max(a.y + a.h, b.y + b.h) - y)};
+  return r;
+}
+
+ScreenMirror::ScreenMirror(Canvas &canvas)
+    : canvas(canvas), overflow(false), scroll(0), events(0), lastEventAt(0) {}
+
+/**
+ * @brief Report a region sent to the panels, render task side
+ * 
+ * @param r 
+ */
+void ScreenMirror::notify(const DirtyRect &r) {
+  if (!updates.push(r)) {
+    overflow.store(true, std::memory_order_release);
+  }
+}
+
+/**
+ * @brief Report every dirty region of the canvas, call right before it is
+ *        flushed
+ * 
+ */
+void ScreenMirror::notifyCanvas() {
+  for (uint8_t i = 0; i < canvas.regionCount(); i++) {
+    notify(canvas.region(i));
+  }
+}
+
+/**
+ * @brief Follow the panel's vertical scroll: every shown row moved
+ * 
+ * @param offset canvas row shown at the top
+ */
+void ScreenMirror::setScroll(int16_t offset) {
+  DirtyRect all = {0, 0, canvas.width(), canvas.height()};
+
+  scroll.store(offset, std::memory_order_release);
+  notify(all);
+}
+
+/**
+ * @brief Take over the connection of the current request as an event
+ *        stream. The response head is written here; the first event gives
+ *        the screen size and marks it all dirty.
+ * 
+ * @param client 
+ * @return false when all viewer slots are taken
+ */
+bool ScreenMirror::addViewer(WiFiClient &client) {
+  for (uint8_t i = 0; i < SCREEN_MAX_VIEWERS; i++) {
+    if (viewers[i].connected()) {
+      continue;
+    }
+
+    char data[32];
+    viewers[i] = client;
+    viewers[i].print("HTTP/1.1 200 OK\r\n"
+                     "Content-Type: text/event-stream\r\n"
+                     "Cache-Control: no-cache\r\n"
+                     "Connection: keep-alive\r\n\r\n"
+                     "retry: 2000\n");
+    snprintf(data, sizeof(data), "%d,%d", canvas.width(), canvas.height());
+    viewers[i].printf("event: size\ndata: %s\n\n", data);
+    viewers[i].printf("event: dirty\ndata: 0,0,%s\n\n", data);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Write one event to every open stream, dropping the closed ones
+ * 
+ * @param event 
+ * @param data NULL for a keepalive comment
+ */
+void ScreenMirror::sendEvent(const char *event, const char *data) {
+  char line[48 + SCREEN_EVENT_RECTS * 20];
+  int length = data ? snprintf(line, sizeof(line), "id: %u\nevent: %s\ndata: %s\n\n", (unsigned)events, event, data)
+                    : snprintf(line, sizeof(line), ":\n\n");
+
+  for (uint8_t i = 0; i < SCREEN_MAX_VIEWERS; i++) {
+    if (viewers[i].connected() && viewers[i].write((const uint8_t *)line, length) != (size_t)length) {
+      viewers[i].stop();
+    }
+  }
+  lastEventAt = millis();
+}
+
+/**
+ * @brief Send the regions flushed since the last call as one "dirty" event
+ *        (data: x,y,w,h;x,y,w,h...) and keep idle streams alive
+ * 
+ */
+void ScreenMirror::poll() {
+  DirtyRect rects[SCREEN_EVENT_RECTS];
+  DirtyRect r, box = {0, 0, 0, 0};
+  uint32_t count = 0;
+  bool tooMany = false;
+
+  while (updates.pop(r)) {
+    if (count < SCREEN_EVENT_RECTS) {
+      rects[count] = r;
+    } else {
+      tooMany = true;
+    }
+    box = count++ == 0 ? r : bounds(box, r);
+  }
+  if (tooMany) {
+    rects[0] = box;
+    count = 1;
+  }
+  if (overflow.exchange(false, std::memory_order_acquire)) {
+    rects[0] = {0, 0, canvas.width(), canvas.height()};
+    count = 1;
+  }
+
+  if (viewerCount() == 0) {
+    return;
+  }
+  if (count == 0) {
+    if (millis() - lastEventAt >= SCREEN_KEEPALIVE_MS) {
+      sendEvent(NULL, NULL);
+    }
+    return;
+  }
+
+  char data[SCREEN_EVENT_RECTS * 20];
+  size_t length = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    length += snprintf(data + length, sizeof(data) - length, "%s%d,%d,%d,%d", i ? ";" : "", rects[i].x,
+                       rects[i].y, rects[i].w, rects[i].h);
+  }
+  events++;
+  sendEvent("dirty", data);
+}
+
+/**
+ * @brief Number of open event streams
+ * 
+ * @return uint8_t 
+ */
+uint8_t ScreenMirror::viewerCount() {
+  uint8_t n = 0;
+
+  for (uint8_t i = 0; i < SCREEN_MAX_VIEWERS; i++) {
+    n += viewers[i].connected();
+  }
+  return n;
+}
+
+/**
+ * @brief Write a region of the screen as RLE runs, row by row. Runs
+ *        continue across rows; rows follow the panel's vertical scroll.
+ * 
+ * @param out 
+ * @param x 
+ * @param y 
+ * @param w 
+ * @param h 
+ * @return size_t bytes written
+ */
+size_t ScreenMirror::writeRle(Print &out, int16_t x, int16_t y, int16_t w, int16_t h) const {
+  int16_t offset = scroll.load(std::memory_order_acquire);
+  int16_t height = canvas.height();
+  uint16_t color = 0;
+  uint16_t run = 0;
+  size_t n = 0;
+
+  for (int16_t row = y; row < y + h; row++) {
+    int16_t canvasRow = (row + offset) % height;
+    for (int16_t col = x; col < x + w; col++) {
+      uint16_t c = canvas.getPixel(col, canvasRow);
+      if (run > 0 && (c != color || run == 256)) {
+        uint8_t op[] = {(uint8_t)(run - 1), (uint8_t)color, (uint8_t)(color >> 8)};
+        n += out.write(op, sizeof(op));
+        run = 0;
+      }
+      color = c;
+      run++;
+    }
+  }
+  if (run > 0) {
+    uint8_t op[] = {(uint8_t)(run - 1), (uint8_t)color, (uint8_t)(color >> 8)};
+    n += out.write(op, sizeof(op));
+  }
+  return n;
+}
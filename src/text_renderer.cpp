@@ -0,0 +1,241 @@
+/**
+ * @file text_renderer.cpp
+ * @author Patrik Sehnoutek <xsehno01@stud.fit.vutbr.cz>
+ * @brief Word wrapping text output with a glyph cache and hardware scrolling
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#include <string.h>
+#include "text_renderer.h"
+
+/**
+ * @brief Drawing target that records the pixels of one character as a mask,
+ *        so the glyphs come from the Adafruit_GFX font itself
+ * 
+ */
+class GlyphRaster : public Adafruit_GFX {
+public:
+  GlyphRaster(uint8_t *mask, int16_t w, int16_t h) : Adafruit_GFX(w, h), mask(mask) {}
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+    if (color && x >= 0 && y >= 0 && x < WIDTH && y < HEIGHT) {
+      mask[y * TEXT_MASK_STRIDE + (x >> 3)] |= 0x80 >> (x & 7);
+    }
+  }
+
+private:
+  uint8_t *mask;
+};
+
+TextRenderer::TextRenderer(Canvas &canvas, TextScrollStep scrollStep)
+    : canvas(canvas), scrollStep(scrollStep), offset(0), size(1), color(0xFFFF), scroll(false),
+      useClock(0), hits(0), misses(0) {
+  memset(cache, 0, sizeof(cache));
+  home();
+}
+
+/**
+ * @brief Cursor to the top left corner after the screen was cleared
+ * 
+ */
+void TextRenderer::home() {
+  left = x = y = 0;
+  offset = 0;
+  truncated = false;
+  wordLength = 0;
+}
+
+/**
+ * @brief Continue at a position, later lines start at its x
+ * 
+ * @param x 
+ * @param y 
+ */
+void TextRenderer::moveTo(int16_t x, int16_t y) {
+  endWord();
+  left = this->x = x;
+  this->y = y;
+  truncated = false;
+}
+
+void TextRenderer::setStyle(uint8_t size, uint16_t color) {
+  size = size ? size : 1;
+  if (size != this->size || color != this->color) {
+    endWord();
+    this->size = size;
+    this->color = color;
+  }
+}
+
+void TextRenderer::setScroll(bool enabled) {
+  if (enabled != scroll) {
+    endWord();
+    scroll = enabled;
+  }
+}
+
+/**
+ * @brief Lay out text. A word is drawn when it is complete, it moves to the
+ *        next line as a whole when it does not fit.
+ * 
+ * @param text 
+ * @param length 
+ */
+void TextRenderer::write(const uint8_t *text, size_t length) {
+  int16_t charWidth = TEXT_GLYPH_W * size;
+
+  for (size_t i = 0; i < length; i++) {
+    uint8_t c = text[i];
+    if (c == '\n') {
+      newline();
+    } else if (c == ' ') {
+      endWord();
+      if (x + charWidth > canvas.width()) {
+        newline();
+      } else {
+        x += charWidth;
+      }
+    } else if (c != '\r') {
+      if (wordLength == TEXT_MAX_WORD || (wordLength + 1) * charWidth > canvas.width() - left) {
+        endWord();
+      }
+      word[wordLength++] = c;
+    }
+  }
+}
+
+void TextRenderer::newline() {
+  endWord();
+  x = left;
+  y += TEXT_GLYPH_H * size;
+}
+
+/**
+ * @brief Draw the word collected so far
+ * 
+ */
+void TextRenderer::endWord() {
+  if (wordLength == 0) {
+    return;
+  }
+
+  if (x > left && x + wordLength * TEXT_GLYPH_W * size > canvas.width()) {
+    x = left;
+    y += TEXT_GLYPH_H * size;
+  }
+  for (uint8_t i = 0; i < wordLength; i++) {
+    drawGlyph(word[i]);
+  }
+  wordLength = 0;
+}
+
+/**
+ * @brief Cached mask of a character at the current size, rasterized on a
+ *        miss into the least recently used slot
+ * 
+ * @param c 
+ * @return const TextRenderer::Glyph& 
+ */
+const TextRenderer::Glyph &TextRenderer::glyph(uint8_t c) {
+  Glyph *slot = &cache[0];
+
+  useClock++;
+  for (Glyph &g : cache) {
+    if (g.size == size && g.c == c) {
+      g.used = useClock;
+      hits++;
+      return g;
+    }
+    if (g.used < slot->used) {
+      slot = &g;
+    }
+  }
+
+  misses++;
+  memset(slot->mask, 0, sizeof(slot->mask));
+  GlyphRaster raster(slot->mask, TEXT_GLYPH_W * size, TEXT_GLYPH_H * size);
+  raster.drawChar(0, 0, c, 1, 1, size, size);
+  slot->c = c;
+  slot->size = size;
+  slot->used = useClock;
+  return *slot;
+}
+
+/**
+ * @brief Make room for a line at y: scroll up in scroll mode, otherwise
+ *        report whether it is still on the screen
+ * 
+ * @return true when the line can be drawn
+ */
+bool TextRenderer::fitLine() {
+  int16_t bottom = y + TEXT_GLYPH_H * size;
+  if (bottom <= canvas.height()) {
+    return true;
+  }
+  if (!scroll || !scrollStep || TEXT_GLYPH_H * size > canvas.height()) {
+    truncated = true;
+    return false;
+  }
+
+  // Clear each row before it comes back at the bottom
+  for (int16_t i = canvas.height(); i < bottom; i++) {
+    canvas.fillRect(0, offset, canvas.width(), 1, 0);
+    offset = (offset + 1) % canvas.height();
+    scrollStep(offset);
+  }
+  y = canvas.height() - TEXT_GLYPH_H * size;
+  return true;
+}
+
+/**
+ * @brief Draw one character at the cursor and advance
+ * 
+ * @param c 
+ */
+void TextRenderer::drawGlyph(uint8_t c) {
+  int16_t w = TEXT_GLYPH_W * size, h = TEXT_GLYPH_H * size;
+
+  if (x > left && x + w > canvas.width()) {
+    x = left;
+    y += h;
+  }
+  if (!fitLine()) {
+    return;
+  }
+
+  int16_t row = (y + offset) % canvas.height();
+  if (size > TEXT_CACHED_SIZE) {
+    canvas.drawChar(x, row, c, color, color, size, size);
+  } else {
+    // A line may wrap around the end of the canvas in scroll mode
+    const Glyph &g = glyph(c);
+    int16_t top = min(h, (int16_t)(canvas.height() - row));
+    canvas.drawMask(x, row, w, top, g.mask, TEXT_MASK_STRIDE, color);
+    if (top < h) {
+      canvas.drawMask(x, 0, w, h - top, g.mask + top * TEXT_MASK_STRIDE, TEXT_MASK_STRIDE, color);
+    }
+  }
+  x += w;
+}
+
+/**
+ * @brief Leave scroll mode: rotate the canvas back so its rows match the
+ *        screen again and return the panel to scroll start 0
+ * 
+ * @param keepImage false when the screen is cleared next anyway
+ */
+void TextRenderer::resetScroll(bool keepImage) {
+  if (offset == 0) {
+    return;
+  }
+
+  if (keepImage) {
+    canvas.scrollRows(offset);
+  }
+  offset = 0;
+  if (scrollStep) {
+    scrollStep(0);
+  }
+}